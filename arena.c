@@ -0,0 +1,333 @@
+/*************************************************************************
+
+ arena - region allocator backed by (transparent) huge pages
+
+ ---------------------------------------------------------------------
+
+                        Copyright (c) 2015-2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+ ----------------------------------------------------------------------
+
+ Blocks are carved out of a list of chunks by bumping an offset, and
+ they are only given back all at once (arena_reset, arena_delete), or
+ when the last block is freed or resized. Each chunk is mapped at a
+ multiple of ARENA_CHUNK and, where available, marked with
+ MADV_HUGEPAGE, so that a large array of nodes is covered by a few TLB
+ entries and costs one page fault per 2 MB instead of one per 4 KB.
+ A new chunk is at least twice as large as the previous one.
+
+*************************************************************************/
+
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+# define ARENA_MMAP 1
+# include <sys/mman.h>
+# ifndef MAP_ANONYMOUS
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+#else
+# define ARENA_MMAP 0
+#endif
+
+#define ARENA_PAGE 4096
+
+#define roundUp(x, a) (((x) + (a) - 1) & ~((size_t) (a) - 1))
+
+
+typedef struct chunk {
+    struct chunk * next;
+    void * raw;         // address to unmap (or free)
+    size_t mapped;      // bytes mapped, including this header
+    size_t size;        // bytes available for blocks
+    size_t used;
+} chunk_t;
+
+struct arena {
+    chunk_t * first;
+    chunk_t * cur;      // chunk of the last block
+    chunk_t * tail;
+    void * last;        // last block allocated (NULL if it was freed)
+    size_t mapped;
+    size_t next;        // minimum size of the next chunk
+    int flags;
+};
+
+#define HEADER roundUp(sizeof(chunk_t), ARENA_ALIGN)
+
+static inline char * chunkData(chunk_t * c){
+    return (char *) c + HEADER;
+}
+
+
+
+static chunk_t * newChunk(size_t size, int flags){
+
+    size_t total = roundUp(size + HEADER, ARENA_CHUNK);
+    char * raw, * base;
+    chunk_t * c;
+
+#if ARENA_MMAP
+    // map one extra chunk and trim both ends, so that base is aligned to ARENA_CHUNK
+    raw = mmap(NULL, total + ARENA_CHUNK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(raw == MAP_FAILED)
+        return NULL;
+    base = (char *) roundUp((uintptr_t) raw, ARENA_CHUNK);
+    if(base > raw)
+        munmap(raw, base - raw);
+    if(raw + ARENA_CHUNK > base)
+        munmap(base + total, raw + ARENA_CHUNK - base);
+    raw = base;
+# ifdef MADV_HUGEPAGE
+    madvise(base, total, MADV_HUGEPAGE);
+# endif
+#else
+    raw = malloc(total + ARENA_ALIGN);
+    if(raw == NULL)
+        return NULL;
+    base = (char *) roundUp((uintptr_t) raw, ARENA_ALIGN);
+#endif
+
+    if(flags & ARENA_PREFAULT){
+        volatile char * p = base;
+        size_t off;
+        for(off = 0; off < total; off += ARENA_PAGE)
+            p[off] = 0;
+    }
+
+    c = (chunk_t *) base;
+    c->next = NULL;
+    c->raw = raw;
+    c->mapped = total;
+    c->size = total - HEADER;
+    c->used = 0;
+    return c;
+}
+
+
+
+static void deleteChunk(chunk_t * c){
+
+#if ARENA_MMAP
+    munmap(c->raw, c->mapped);
+#else
+    free(c->raw);
+#endif
+}
+
+
+
+arena_t * arena_new(size_t size, int flags){
+
+    arena_t * a = calloc(1, sizeof(arena_t));
+    if(a == NULL)
+        return NULL;
+    a->flags = flags;
+    a->next = (size > ARENA_CHUNK) ? size : ARENA_CHUNK;
+    return a;
+}
+
+
+
+void arena_delete(arena_t * a){
+
+    chunk_t * c, * next;
+
+    if(a == NULL) return;
+    for(c = a->first; c != NULL; c = next){
+        next = c->next;
+        deleteChunk(c);
+    }
+    free(a);
+}
+
+
+
+void arena_reset(arena_t * a){
+
+    chunk_t * c;
+
+    for(c = a->first; c != NULL; c = c->next)
+        c->used = 0;
+    a->cur = a->first;
+    a->last = NULL;
+}
+
+
+
+void * arena_alloc(arena_t * a, size_t size){
+
+    chunk_t * c = a->cur;
+    void * p;
+
+    size = roundUp(size, ARENA_ALIGN);
+
+    // chunks after the current one are empty (they are only reached again after arena_reset)
+    while(c != NULL && c->used + size > c->size)
+        c = c->next;
+
+    if(c == NULL){
+        c = newChunk((size > a->next) ? size : a->next, a->flags);
+        if(c == NULL)
+            return NULL;
+        if(a->tail) a->tail->next = c;
+        else a->first = c;
+        a->tail = c;
+        a->mapped += c->mapped;
+        a->next = 2 * c->mapped;
+    }
+
+    p = chunkData(c) + c->used;
+    c->used += size;
+    a->cur = c;
+    a->last = p;
+    return p;
+}
+
+
+
+void * arena_calloc(arena_t * a, size_t nmemb, size_t size){
+
+    void * p;
+
+    if(size != 0 && nmemb > (size_t) -1 / size)
+        return NULL;
+    p = arena_alloc(a, nmemb * size);
+    if(p != NULL)
+        memset(p, 0, nmemb * size);
+    return p;
+}
+
+
+
+/* Unmap chunk c, which must not be the current one */
+static void dropChunk(arena_t * a, chunk_t * c){
+
+    chunk_t ** link = &a->first, * prev = NULL;
+
+    while(*link != c){
+        prev = *link;
+        link = &prev->next;
+    }
+    *link = c->next;
+    if(a->tail == c)
+        a->tail = prev;
+    a->mapped -= c->mapped;
+    deleteChunk(c);
+}
+
+
+
+void * arena_realloc(arena_t * a, void * p, size_t oldsize, size_t newsize){
+
+    chunk_t * c = a->cur;
+    int alone;
+    void * q;
+
+    if(p == NULL)
+        return arena_alloc(a, newsize);
+
+    // a block that grows past its chunk and was alone in it leaves an empty chunk behind
+    alone = (p == a->last && p == chunkData(c));
+    if(p == a->last){
+        size_t off = (char *) p - chunkData(c);
+        size_t size = roundUp(newsize, ARENA_ALIGN);
+        if(off + size <= c->size){
+            c->used = off + size;
+            return p;
+        }
+    }
+    if(newsize <= oldsize)
+        return p;
+
+    q = arena_alloc(a, newsize);
+    if(q != NULL){
+        memcpy(q, p, oldsize);
+        if(alone && a->cur != c)
+            dropChunk(a, c);
+    }
+    return q;
+}
+
+
+
+void arena_free(arena_t * a, void * p){
+
+    if(p != NULL && p == a->last){
+        a->cur->used = (char *) p - chunkData(a->cur);
+        a->last = NULL;
+    }
+}
+
+
+
+arena_mark_t arena_mark(const arena_t * a){
+
+    arena_mark_t mark = {0, 0};
+    chunk_t * c;
+
+    // a position rather than a pointer, as arena_realloc may unmap a chunk emptied after the mark
+    for(c = a->first; c != NULL && c != a->cur; c = c->next)
+        mark.chunk++;
+    if(a->cur != NULL){
+        mark.chunk++;
+        mark.used = a->cur->used;
+    }
+    return mark;
+}
+
+
+
+void arena_rewind(arena_t * a, arena_mark_t mark){
+
+    chunk_t * c = a->first;
+    size_t i;
+
+    if(mark.chunk == 0){
+        arena_reset(a);
+        return;
+    }
+    for(i = 1; i < mark.chunk && c != NULL; i++)
+        c = c->next;
+    if(c == NULL){
+        arena_reset(a);
+        return;
+    }
+    // a chunk dropped after the mark was empty at the mark, so the one now in its place is too
+    if(c->used > mark.used)
+        c->used = mark.used;
+    a->cur = c;
+    for(c = c->next; c != NULL; c = c->next)
+        c->used = 0;
+    a->last = NULL;
+}
+
+
+
+size_t arena_mapped(const arena_t * a){
+
+    return a->mapped;
+}
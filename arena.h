@@ -0,0 +1,80 @@
+/*************************************************************************
+
+ arena.h
+
+ ---------------------------------------------------------------------
+
+                       Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+
+
+*************************************************************************/
+#ifndef GHSS_ARENA_H_
+#define GHSS_ARENA_H_
+
+#include <stddef.h>
+
+/* Memory is taken from chunks of at least ARENA_CHUNK bytes, aligned to ARENA_CHUNK so that the
+   kernel may back them with huge pages */
+#define ARENA_CHUNK ((size_t) 2 << 20)
+
+/* Every allocation is aligned to ARENA_ALIGN bytes (a cache line) */
+#define ARENA_ALIGN 64
+
+/* Flags of arena_new */
+#define ARENA_PREFAULT 1    /* touch every page of a chunk as soon as it is mapped */
+
+typedef struct arena arena_t;
+
+/* New arena, whose first chunk has room for (at least) 'size' bytes */
+arena_t * arena_new(size_t size, int flags);
+
+/* Release all the memory of the arena */
+void arena_delete(arena_t * a);
+
+/* Make all the memory of the arena available again, without returning it to the system */
+void arena_reset(arena_t * a);
+
+/* Allocate 'size' bytes (arena_calloc also sets them to zero). Returns NULL if out of memory. */
+void * arena_alloc(arena_t * a, size_t size);
+void * arena_calloc(arena_t * a, size_t nmemb, size_t size);
+
+/* Resize the block p (of 'oldsize' bytes) to 'newsize' bytes. The last block allocated is resized
+   in place whenever it fits in its chunk, other blocks are copied. p may be NULL. */
+void * arena_realloc(arena_t * a, void * p, size_t oldsize, size_t newsize);
+
+/* Give back p if it is the last block allocated (otherwise it is only reclaimed by arena_reset) */
+void arena_free(arena_t * a, void * p);
+
+/* Position in an arena: arena_rewind gives back every block allocated after arena_mark */
+typedef struct arena_mark {
+    size_t chunk;       // position of the current chunk, counting from 1 (0 if none was mapped)
+    size_t used;
+} arena_mark_t;
+
+arena_mark_t arena_mark(const arena_t * a);
+void arena_rewind(arena_t * a, arena_mark_t mark);
+
+/* Bytes mapped by the arena */
+size_t arena_mapped(const arena_t * a);
+
+#endif
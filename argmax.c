@@ -0,0 +1,283 @@
+/*************************************************************************
+
+ argmax - index of the maximum of an array of doubles
+
+ ---------------------------------------------------------------------
+
+                        Copyright (c) 2015-2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+ ----------------------------------------------------------------------
+
+ The argmax is computed in two passes: the first one finds the maximum
+ value and the second one the first entry equal to it. Both are exact,
+ so every kernel returns the same index as a sequential scan that keeps
+ the first of the largest entries.
+
+*************************************************************************/
+
+#include "argmax.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define ARGMAX_X86 1
+# include <immintrin.h>
+#else
+# define ARGMAX_X86 0
+#endif
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+// below this size the array is not split among OpenMP threads
+#ifndef ARGMAX_OMP_MIN_N
+#define ARGMAX_OMP_MIN_N (1 << 18)
+#endif
+
+
+typedef double (*maxfn_t)(const double * v, ghss_index_t n);
+typedef ghss_index_t (*findfn_t)(const double * v, ghss_index_t n, double m);
+
+
+
+/* -------------------------------------- Scalar ----------------------------------------------*/
+
+
+static double maxScalar(const double * v, ghss_index_t n){
+
+    double m = v[0];
+    ghss_index_t i;
+    for(i = 1; i < n; i++)
+        m = (v[i] > m) ? v[i] : m;
+    return m;
+}
+
+
+
+static ghss_index_t findScalar(const double * v, ghss_index_t n, double m){
+
+    ghss_index_t i;
+    for(i = 0; i < n; i++)
+        if(v[i] == m) return i;
+    return n;
+}
+
+
+
+/* -------------------------------------- x86 SIMD --------------------------------------------*/
+
+#if ARGMAX_X86
+
+__attribute__ ((target("avx2")))
+static double maxAVX2(const double * v, ghss_index_t n){
+
+    double m, t[4];
+    ghss_index_t i = 0;
+
+    if(n < 16)
+        return maxScalar(v, n);
+
+    __m256d m0 = _mm256_loadu_pd(v);
+    __m256d m1 = _mm256_loadu_pd(v + 4);
+    __m256d m2 = _mm256_loadu_pd(v + 8);
+    __m256d m3 = _mm256_loadu_pd(v + 12);
+    for(i = 16; i + 16 <= n; i += 16){
+        m0 = _mm256_max_pd(m0, _mm256_loadu_pd(v + i));
+        m1 = _mm256_max_pd(m1, _mm256_loadu_pd(v + i + 4));
+        m2 = _mm256_max_pd(m2, _mm256_loadu_pd(v + i + 8));
+        m3 = _mm256_max_pd(m3, _mm256_loadu_pd(v + i + 12));
+    }
+    m0 = _mm256_max_pd(_mm256_max_pd(m0, m1), _mm256_max_pd(m2, m3));
+    _mm256_storeu_pd(t, m0);
+
+    m = maxScalar(t, 4);
+    for(; i < n; i++)
+        m = (v[i] > m) ? v[i] : m;
+    return m;
+}
+
+
+
+__attribute__ ((target("avx2")))
+static ghss_index_t findAVX2(const double * v, ghss_index_t n, double m){
+
+    __m256d vm = _mm256_set1_pd(m);
+    ghss_index_t i;
+    int mask;
+
+    for(i = 0; i + 4 <= n; i += 4){
+        mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(v + i), vm, _CMP_EQ_OQ));
+        if(mask) return i + __builtin_ctz(mask);
+    }
+    return i + findScalar(v + i, n - i, m);
+}
+
+
+
+__attribute__ ((target("avx512f")))
+static double maxAVX512(const double * v, ghss_index_t n){
+
+    double m;
+    ghss_index_t i = 0;
+
+    if(n < 32)
+        return maxScalar(v, n);
+
+    __m512d m0 = _mm512_loadu_pd(v);
+    __m512d m1 = _mm512_loadu_pd(v + 8);
+    __m512d m2 = _mm512_loadu_pd(v + 16);
+    __m512d m3 = _mm512_loadu_pd(v + 24);
+    for(i = 32; i + 32 <= n; i += 32){
+        m0 = _mm512_max_pd(m0, _mm512_loadu_pd(v + i));
+        m1 = _mm512_max_pd(m1, _mm512_loadu_pd(v + i + 8));
+        m2 = _mm512_max_pd(m2, _mm512_loadu_pd(v + i + 16));
+        m3 = _mm512_max_pd(m3, _mm512_loadu_pd(v + i + 24));
+    }
+    m0 = _mm512_max_pd(_mm512_max_pd(m0, m1), _mm512_max_pd(m2, m3));
+
+    m = _mm512_reduce_max_pd(m0);
+    for(; i < n; i++)
+        m = (v[i] > m) ? v[i] : m;
+    return m;
+}
+
+
+
+__attribute__ ((target("avx512f")))
+static ghss_index_t findAVX512(const double * v, ghss_index_t n, double m){
+
+    __m512d vm = _mm512_set1_pd(m);
+    ghss_index_t i;
+    __mmask8 mask;
+
+    for(i = 0; i + 8 <= n; i += 8){
+        mask = _mm512_cmp_pd_mask(_mm512_loadu_pd(v + i), vm, _CMP_EQ_OQ);
+        if(mask) return i + __builtin_ctz(mask);
+    }
+    return i + findScalar(v + i, n - i, m);
+}
+
+#endif
+
+
+
+/* -------------------------------------- Dispatch --------------------------------------------*/
+
+
+typedef struct kernels {
+    maxfn_t max;
+    findfn_t find;
+    const char * name;
+} kernels_t;
+
+static const kernels_t scalarKernels = {maxScalar, findScalar, "scalar"};
+#if ARGMAX_X86
+static const kernels_t avx2Kernels = {maxAVX2, findAVX2, "avx2"};
+static const kernels_t avx512Kernels = {maxAVX512, findAVX512, "avx512"};
+#endif
+
+// the kernels picked for this machine, set by the first call
+static const kernels_t * kernels = NULL;
+
+
+/*
+ * The kernels for this machine. Concurrent first calls may all pick them; the choice is
+ * published with a single release store of a pointer to constant data, so that a thread that
+ * sees the pointer also sees the kernels it points to.
+ */
+static const kernels_t * getKernels(void){
+
+    const kernels_t * k = __atomic_load_n(&kernels, __ATOMIC_ACQUIRE);
+
+    if(k != NULL)
+        return k;
+
+    k = &scalarKernels;
+#if ARGMAX_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        k = &avx512Kernels;
+    else if(__builtin_cpu_supports("avx2"))
+        k = &avx2Kernels;
+#endif
+    __atomic_store_n(&kernels, k, __ATOMIC_RELEASE);
+    return k;
+}
+
+
+
+const char * argmax_kernel(void){
+
+    return getKernels()->name;
+}
+
+
+
+ghss_index_t argmax(const double * v, ghss_index_t n){
+
+    const kernels_t * k = getKernels();
+
+#ifdef _OPENMP
+    if(n >= ARGMAX_OMP_MIN_N && omp_get_max_threads() > 1){
+
+        // split v into one chunk per thread, the first chunk that contains the maximum has the answer
+        ghss_index_t nchunks = omp_get_max_threads();
+        ghss_index_t chunk = (n + nchunks - 1) / nchunks;
+        double cmax[nchunks];
+        double m;
+        int c;
+
+        #pragma omp parallel for schedule(static)
+        for(c = 0; c < nchunks; c++){
+            ghss_index_t from = c * chunk;
+            ghss_index_t size = (from + chunk <= n) ? chunk : n - from;
+            cmax[c] = (size > 0) ? k->max(v + from, size) : ARGMAX_MASKED;
+        }
+
+        m = cmax[0];
+        for(c = 1; c < nchunks; c++)
+            m = (cmax[c] > m) ? cmax[c] : m;
+        for(c = 0; cmax[c] != m; c++);
+
+        return c * chunk + k->find(v + c * chunk, (c * chunk + chunk <= n) ? chunk : n - c * chunk, m);
+    }
+#endif
+
+    return k->find(v, n, k->max(v, n));
+}
+
+
+
+ghss_index_t argmax_key(const double * v, const ghss_index_t * key, ghss_index_t n){
+
+    const kernels_t * k = getKernels();
+    ghss_index_t i, j, best;
+    double m;
+
+    m = k->max(v, n);
+    best = k->find(v, n, m);
+    for(i = best + 1; i < n; i = j + 1){
+        j = i + k->find(v + i, n - i, m);
+        if(j < n && key[j] < key[best])
+            best = j;
+    }
+    return best;
+}
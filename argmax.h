@@ -0,0 +1,51 @@
+/*************************************************************************
+
+ argmax.h
+
+ ---------------------------------------------------------------------
+
+                       Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+             
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+
+
+*************************************************************************/
+#ifndef GHSS_ARGMAX_H_
+#define GHSS_ARGMAX_H_
+
+#include <float.h>
+
+#include "gHSS.h"
+
+/* Value of the entries that must never be returned by argmax (e.g., points already selected) */
+#define ARGMAX_MASKED (-DBL_MAX)
+
+/* Index of the maximum of v[0], ..., v[n-1] (the lowest one in case of ties). n must be
+   positive and at least one of the entries must not be ARGMAX_MASKED. */
+ghss_index_t argmax(const double * v, ghss_index_t n);
+
+/* Same as argmax, but in case of ties the index i with the lowest key[i] is returned */
+ghss_index_t argmax_key(const double * v, const ghss_index_t * key, ghss_index_t n);
+
+/* Name of the kernel used by argmax in this machine ("scalar", "avx2" or "avx512") */
+const char * argmax_kernel(void);
+
+#endif
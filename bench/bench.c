@@ -0,0 +1,609 @@
+/*************************************************************************
+
+ gHSS-bench: benchmark of greedyhss on synthetic data sets
+
+ ---------------------------------------------------------------------
+
+                        Copyright (c) 2015-2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+ ----------------------------------------------------------------------
+
+ Each case (dimension, generator, n, k) is run in a child process, so
+ that its peak resident set size is measured on its own and a case that
+ exceeds the time limit can be killed. Only the call to greedyhss is
+ timed. The points are in [0,1]^d and the reference point is
+ (1.1, ..., 1.1). The results are written as a JSON object.
+
+ In Linux, the cache references and misses (of the last level cache and
+ of the L1 data cache) of the call are also counted, with perf_event_open,
+ where the kernel allows it (see /proc/sys/kernel/perf_event_paranoid).
+ Counters that cannot be read are written as null.
+
+*************************************************************************/
+#include "../gHSS.h"
+#include "../argmax.h"
+#include "../timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#ifdef __USE_GNU
+extern char *program_invocation_short_name;
+#else
+char *program_invocation_short_name;
+#endif
+
+
+
+/* -------------------------------------- Generators ---------------------------------------------*/
+
+
+/* xorshift64*, so that the data sets are the same in every platform */
+static unsigned long long rng_state;
+
+static double urand(void){
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return ((rng_state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double nrand(void){
+    double u = urand(), v = urand();
+    return sqrt(-2 * log(1 - u)) * cos(2 * M_PI * v);
+}
+
+
+/* point with nonnegative coordinates and sum(x_i^p) = 1, from a random direction */
+static void frontPoint(double * x, int d, double p){
+
+    int i;
+    double s = 0;
+    for(i = 0; i < d; i++){
+        x[i] = -log(1 - urand());
+        s += x[i];
+    }
+    for(i = 0; i < d; i++)
+        x[i] = pow(x[i] / s, 1 / p);
+}
+
+
+static void genLinear(double * x, int d, int j, int n){
+    (void) j; (void) n;
+    frontPoint(x, d, 1);
+}
+
+static void genConvex(double * x, int d, int j, int n){
+    (void) j; (void) n;
+    frontPoint(x, d, 0.5);
+}
+
+static void genConcave(double * x, int d, int j, int n){
+    (void) j; (void) n;
+    frontPoint(x, d, 3);
+}
+
+/* uniformly distributed on the unit sphere */
+static void genSpherical(double * x, int d, int j, int n){
+
+    int i;
+    double s = 0;
+    (void) j; (void) n;
+    for(i = 0; i < d; i++){
+        x[i] = fabs(nrand());
+        s += x[i] * x[i];
+    }
+    for(i = 0; i < d; i++)
+        x[i] /= sqrt(s);
+}
+
+/* linear front in the first d-1 coordinates, the last one is constant */
+static void genDegenerate(double * x, int d, int j, int n){
+    (void) j; (void) n;
+    frontPoint(x, d - 1, 1);
+    x[d-1] = 0.5;
+}
+
+/* uniform in [0,1]^d, i.e., most points are dominated */
+static void genDominated(double * x, int d, int j, int n){
+
+    int i;
+    (void) j; (void) n;
+    for(i = 0; i < d; i++)
+        x[i] = urand();
+}
+
+/* linear front with about sqrt(n) distinct points */
+static void genDuplicates(double * x, int d, int j, int n){
+
+    static double * distinct = NULL;
+    static int ndistinct = 0;
+    int i, m = (int) sqrt(n) + 1;
+
+    if(j == 0){
+        free(distinct);
+        distinct = malloc(m * d * sizeof(double));
+        for(ndistinct = 0; ndistinct < m; ndistinct++)
+            frontPoint(distinct + ndistinct * d, d, 1);
+    }
+    j = (int) (urand() * ndistinct);
+    for(i = 0; i < d; i++)
+        x[i] = distinct[j * d + i];
+}
+
+
+typedef struct generator {
+    const char * name;
+    void (*point)(double * x, int d, int j, int n);
+} generator_t;
+
+static const generator_t generators[] = {
+    {"linear", genLinear},
+    {"concave", genConcave},
+    {"convex", genConvex},
+    {"spherical", genSpherical},
+    {"degenerate", genDegenerate},
+    {"dominated", genDominated},
+    {"duplicates", genDuplicates},
+    {NULL, NULL}
+};
+
+
+
+static double * generate(const generator_t * g, int d, int n, unsigned long long seed){
+
+    int j;
+    double * data = malloc((size_t) n * d * sizeof(double));
+
+    rng_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    for(j = 0; j < n; j++)
+        g->point(data + (size_t) j * d, d, j, n);
+    return data;
+}
+
+
+
+/* --------------------------------------- Counters ----------------------------------------------*/
+
+
+#define NCOUNTERS 3
+
+static const char * const counterNames[NCOUNTERS] = {"cache_references", "cache_misses", "l1d_misses"};
+
+typedef struct counters {
+    int fd[NCOUNTERS];
+} counters_t;
+
+
+/* Open the counters of this process, disabled. A counter that cannot be opened has fd -1. */
+static void openCounters(counters_t * c){
+
+    int i;
+#ifdef __linux__
+    static const struct { unsigned type; unsigned long long config; } events[NCOUNTERS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                             | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    };
+    struct perf_event_attr attr;
+
+    for(i = 0; i < NCOUNTERS; i++){
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        c->fd[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#else
+    for(i = 0; i < NCOUNTERS; i++)
+        c->fd[i] = -1;
+#endif
+}
+
+
+static void enableCounters(const counters_t * c, int on){
+
+    int i;
+#ifdef __linux__
+    for(i = 0; i < NCOUNTERS; i++){
+        if(c->fd[i] >= 0){
+            if(on) ioctl(c->fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(c->fd[i], on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#else
+    (void) c; (void) on; (void) i;
+#endif
+}
+
+
+/* Read and close the counters. A counter that could not be read is set to -1. */
+static void readCounters(counters_t * c, long long * value){
+
+    int i;
+    for(i = 0; i < NCOUNTERS; i++){
+        value[i] = -1;
+        if(c->fd[i] >= 0){
+            if(read(c->fd[i], &value[i], sizeof(value[i])) != sizeof(value[i]))
+                value[i] = -1;
+            close(c->fd[i]);
+        }
+    }
+}
+
+
+
+/* ---------------------------------------- Cases ------------------------------------------------*/
+
+
+typedef struct result {
+    double wall;
+    double cpu;
+    double hv;
+    long long counter[NCOUNTERS];   // -1 if not counted
+} result_t;
+
+
+/*
+ * Run one case in a child process. Returns 0 on success, 1 if the time limit was exceeded and
+ * -1 if the child failed. 'maxrss' is the peak resident set size of the child in KiB.
+ */
+static int runCase(const generator_t * g, int d, int n, int k, unsigned long long seed,
+                   int timeout, result_t * res, long * maxrss){
+
+    int fd[2], status;
+    pid_t pid;
+    struct rusage usage;
+
+    if(pipe(fd) != 0){
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    pid = fork();
+    if(pid < 0){
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+
+    if(pid == 0){
+        double ref[3] = {1.1, 1.1, 1.1};
+        double * data = generate(g, d, n, seed);
+        double * contribs = malloc(k * sizeof(double));
+        ghss_index_t * selected = malloc(k * sizeof(ghss_index_t));
+        result_t r;
+        counters_t counters;
+
+        close(fd[0]);
+        openCounters(&counters);
+        if(timeout > 0) alarm(timeout);
+
+        Timer_start();
+        enableCounters(&counters, 1);
+        r.hv = greedyhss(data, d, n, k, ref, contribs, selected);
+        enableCounters(&counters, 0);
+        r.cpu = Timer_elapsed_virtual();
+        r.wall = Timer_elapsed_real();
+        readCounters(&counters, r.counter);
+
+        if(write(fd[1], &r, sizeof(r)) != sizeof(r))
+            _exit(EXIT_FAILURE);
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(fd[1]);
+    if(read(fd[0], res, sizeof(*res)) != sizeof(*res))
+        memset(res, 0, sizeof(*res));
+    close(fd[0]);
+
+    if(wait4(pid, &status, 0, &usage) < 0){
+        perror("wait4");
+        exit(EXIT_FAILURE);
+    }
+    *maxrss = usage.ru_maxrss;
+
+    if(WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM)
+        return 1;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) ? 0 : -1;
+}
+
+
+
+/* ---------------------------------------- Main -------------------------------------------------*/
+
+
+static void usage(void){
+
+    printf("\n"
+"Usage: %s [OPTIONS]\n\n", program_invocation_short_name);
+
+    printf(
+"Run greedyhss on synthetic data sets and write the results in JSON.\n\n"
+"Options:\n"
+" -h, --help           print this summary and exit.                          \n"
+" -d, --dimensions=LIST dimensions (default \"2,3\")                          \n"
+" -g, --generators=LIST data sets (default: all), among linear, concave,      \n"
+"                      convex, spherical, degenerate, dominated, duplicates  \n"
+" -n, --sizes=MIN:MAX  numbers of points, powers of 10 from MIN to MAX       \n"
+"                      (default 1000:100000)                                 \n"
+" -k, --ratios=LIST    values of k/n (default \"0.01,0.1,0.5\")              \n"
+" -e, --engine=NAME    algorithm (auto, list, array, tree or lazy)           \n"
+" -L, --layout=NAME    order of the points in memory for the list engine     \n"
+"                      (input, axis or zorder; default input)                \n"
+" -t, --threads=N      threads for the sweeps in 3D (default 1)              \n"
+" -r, --repeat=R       run each case R times (default 1)                     \n"
+" -T, --timeout=S      kill a case after S seconds and skip the larger ones  \n"
+"                      of the same kind (default 600, 0: never)              \n"
+" -S, --seed=N         seed of the random number generator (default 1)       \n"
+" -o, --output=FILE    write the results to FILE instead of stdout           \n"
+"\n");
+}
+
+
+
+static int engineNumber(const char * name){
+
+    if(strcmp(name, "auto") == 0) return GHSS_ENGINE_AUTO;
+    if(strcmp(name, "list") == 0) return GHSS_ENGINE_LIST;
+    if(strcmp(name, "array") == 0) return GHSS_ENGINE_ARRAY;
+    if(strcmp(name, "tree") == 0) return GHSS_ENGINE_TREE;
+    if(strcmp(name, "lazy") == 0) return GHSS_ENGINE_LAZY;
+    fprintf(stderr, "%s: invalid engine '%s'\n", program_invocation_short_name, name);
+    exit(EXIT_FAILURE);
+}
+
+
+
+static int layoutNumber(const char * name){
+
+    if(strcmp(name, "input") == 0) return GHSS_LAYOUT_INPUT;
+    if(strcmp(name, "axis") == 0) return GHSS_LAYOUT_AXIS;
+    if(strcmp(name, "zorder") == 0) return GHSS_LAYOUT_ZORDER;
+    fprintf(stderr, "%s: invalid layout '%s'\n", program_invocation_short_name, name);
+    exit(EXIT_FAILURE);
+}
+
+
+
+static int parseList(const char * str, double * v, int max){
+
+    int nv = 0;
+    char * end;
+
+    while(nv < max){
+        v[nv++] = strtod(str, &end);
+        if(end == str || (*end != ',' && *end != '\0')){
+            fprintf(stderr, "%s: invalid list '%s'\n", program_invocation_short_name, str);
+            exit(EXIT_FAILURE);
+        }
+        if(*end == '\0') break;
+        str = end + 1;
+    }
+    return nv;
+}
+
+
+
+int main(int argc, char *argv[]){
+
+    int opt, i, a, b, c, rep;
+    int dims[2] = {2, 3}, ndims = 2;
+    int usegen[sizeof(generators) / sizeof(generators[0])];
+    long minn = 1000, maxn = 100000, n;
+    double ratios[16] = {0.01, 0.1, 0.5}, v[16];
+    int nratios = 3, repeat = 1, timeout = 600, nthreads = 1;
+    const char * enginename = "auto";
+    const char * layoutname = "input";
+    unsigned long long seed = 1;
+    FILE * out = stdout;
+    int first = 1;
+
+    static struct option long_options[] = {
+        {"help",       no_argument,       NULL, 'h'},
+        {"dimensions", required_argument, NULL, 'd'},
+        {"generators", required_argument, NULL, 'g'},
+        {"sizes",      required_argument, NULL, 'n'},
+        {"ratios",     required_argument, NULL, 'k'},
+        {"engine",     required_argument, NULL, 'e'},
+        {"layout",     required_argument, NULL, 'L'},
+        {"threads",    required_argument, NULL, 't'},
+        {"repeat",     required_argument, NULL, 'r'},
+        {"timeout",    required_argument, NULL, 'T'},
+        {"seed",       required_argument, NULL, 'S'},
+        {"output",     required_argument, NULL, 'o'},
+
+        {NULL, 0, NULL, 0} /* marks end of list */
+    };
+
+#ifndef __USE_GNU
+    program_invocation_short_name = argv[0];
+#endif
+
+    for(i = 0; generators[i].name != NULL; i++)
+        usegen[i] = 1;
+
+    while (0 < (opt = getopt_long (argc, argv, "hd:g:n:k:e:L:t:r:T:S:o:",
+                                   long_options, NULL))) {
+        switch (opt) {
+        case 'd':
+            ndims = parseList(optarg, v, 2);
+            for(i = 0; i < ndims; i++){
+                dims[i] = (int) v[i];
+                if(dims[i] != 2 && dims[i] != 3){
+                    fprintf(stderr, "%s: only 2 and 3 dimensions are supported\n",
+                            program_invocation_short_name);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            break;
+
+        case 'g': {
+            char * list = strdup(optarg), * name;
+            for(i = 0; generators[i].name != NULL; i++)
+                usegen[i] = 0;
+            for(name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")){
+                for(i = 0; generators[i].name != NULL && strcmp(generators[i].name, name) != 0; i++);
+                if(generators[i].name == NULL){
+                    fprintf(stderr, "%s: invalid generator '%s'\n", program_invocation_short_name, name);
+                    exit(EXIT_FAILURE);
+                }
+                usegen[i] = 1;
+            }
+            free(list);
+            break;
+        }
+
+        case 'n':
+            if(sscanf(optarg, "%ld:%ld", &minn, &maxn) != 2 || minn < 1 || maxn < minn){
+                fprintf(stderr, "%s: invalid sizes '%s'\n", program_invocation_short_name, optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case 'k':
+            nratios = parseList(optarg, ratios, 16);
+            break;
+
+        case 'e':
+            gHSS_set_engine(engineNumber(optarg));
+            enginename = optarg;
+            break;
+
+        case 'L':
+            gHSS_set_layout(layoutNumber(optarg));
+            layoutname = optarg;
+            break;
+
+        case 't':
+            nthreads = atoi(optarg);
+            gHSS_set_threads(nthreads);
+            break;
+
+        case 'r':
+            repeat = atoi(optarg);
+            break;
+
+        case 'T':
+            timeout = atoi(optarg);
+            break;
+
+        case 'S':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+
+        case 'o':
+            out = fopen(optarg, "w");
+            if(out == NULL){
+                perror(optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case 'h':
+            usage();
+            exit(EXIT_SUCCESS);
+
+        default:
+            fprintf (stderr, "Try `%s --help' for more information.\n",
+                     program_invocation_short_name);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fprintf(out, "{\n  \"version\": \"%s\",\n  \"argmax\": \"%s\",\n  \"engine\": \"%s\",\n"
+            "  \"layout\": \"%s\",\n  \"threads\": %d,\n  \"seed\": %llu,\n  \"date\": %ld,\n"
+            "  \"results\": [",
+            VERSION, argmax_kernel(), enginename, layoutname, nthreads, seed, (long) time(NULL));
+
+    for(a = 0; a < ndims; a++){
+        for(b = 0; generators[b].name != NULL; b++){
+            if(!usegen[b]) continue;
+            for(c = 0; c < nratios; c++){
+                int timedout = 0;
+                for(n = minn; n <= maxn && !timedout; n *= 10){
+                    int k = (int) (ratios[c] * n + 0.5);
+                    if(k < 1) k = 1;
+                    if(k > n) k = n;
+
+                    for(rep = 0; rep < repeat && !timedout; rep++){
+                        result_t res;
+                        long maxrss;
+                        int status = runCase(generators + b, dims[a], n, k, seed, timeout, &res, &maxrss);
+
+                        fprintf(out, "%s\n    {\"d\": %d, \"generator\": \"%s\", \"n\": %ld, \"k\": %d, "
+                                "\"repeat\": %d, \"status\": \"%s\"", first ? "" : ",",
+                                dims[a], generators[b].name, n, k, rep,
+                                (status == 0) ? "ok" : (status == 1) ? "timeout" : "failed");
+                        if(status == 0){
+                            fprintf(out, ", \"wall\": %.6f, \"cpu\": %.6f, \"hv\": %.15g",
+                                    res.wall, res.cpu, res.hv);
+                            for(i = 0; i < NCOUNTERS; i++){
+                                if(res.counter[i] >= 0)
+                                    fprintf(out, ", \"%s\": %lld", counterNames[i], res.counter[i]);
+                                else
+                                    fprintf(out, ", \"%s\": null", counterNames[i]);
+                            }
+                        }
+                        fprintf(out, ", \"maxrss_kb\": %ld}", maxrss);
+                        fflush(out);
+                        first = 0;
+                        timedout = (status == 1);
+
+                        if(status == 0 && res.counter[1] >= 0)
+                            fprintf(stderr, "%dD %-10s n=%-9ld k=%-9d %10.3fs %10ld KiB %14lld misses\n",
+                                    dims[a], generators[b].name, n, k, res.wall, maxrss, res.counter[1]);
+                        else if(status == 0)
+                            fprintf(stderr, "%dD %-10s n=%-9ld k=%-9d %10.3fs %10ld KiB\n", dims[a],
+                                    generators[b].name, n, k, res.wall, maxrss);
+                        else
+                            fprintf(stderr, "%dD %-10s n=%-9ld k=%-9d %s\n", dims[a], generators[b].name,
+                                    n, k, (status == 1) ? "timeout" : "failed");
+                    }
+                }
+            }
+        }
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if(out != stdout) fclose(out);
+
+    return EXIT_SUCCESS;
+}
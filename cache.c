@@ -0,0 +1,288 @@
+/*************************************************************************
+
+ gHSS: sidecar files with the points of a file, already parsed and sorted
+
+ ---------------------------------------------------------------------
+
+                        Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+ ----------------------------------------------------------------------
+
+ A sidecar file is a header followed by the cumulative sizes of the
+ sets (nsets indices), the points (npoints * nobj doubles) and, in 2 and
+ 3 dimensions, the order of the points of each set along each dimension
+ (npoints * nobj indices, the output of greedyhss_sort for each set, one
+ set after the other). The indices are int32, or int64 in a GHSS_LARGE
+ build. Everything is in the byte order of the machine that wrote it,
+ and a sidecar written by another machine, or by a build of gHSS with
+ another precision (whose sort order may differ) or size of indices, is
+ ignored.
+
+ The header records the size, modification time and a checksum of the
+ contents of the source file, which are checked before the sidecar is
+ used, and a checksum of the rest of the sidecar, which is checked after
+ reading it. The checksum reads the source file, which is much faster
+ than parsing it. A sidecar is written to a temporary file that is then
+ renamed, so that a concurrent run never reads half of it.
+
+*************************************************************************/
+
+#include "cache.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_MAGIC     "gHSSsort"
+#define CACHE_VERSION   1
+#define CACHE_BYTEORDER 0x01020304u
+#define CACHE_UNION     1
+#define CACHE_LARGE     2
+
+#ifdef __APPLE__
+# define st_mtim st_mtimespec
+#endif
+
+#if GHSS_FLOAT
+# define CACHE_COORDSIZE sizeof(float)
+#else
+# define CACHE_COORDSIZE sizeof(double)
+#endif
+
+typedef struct cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;
+    uint32_t coordsize;         /* size of the coordinates kept by gHSS */
+    uint32_t flags;             /* CACHE_UNION, CACHE_LARGE */
+    uint64_t size;              /* of the source file */
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t checksum;          /* of the contents of the source file */
+    int32_t nobj;
+    int32_t nsets;
+    uint64_t npoints;
+    uint64_t payload;           /* checksum of the rest of the sidecar */
+} cache_header_t;
+
+#define CHECKSUM_SEED  0xcbf29ce484222325ull
+#define CHECKSUM_PRIME 0x100000001b3ull
+
+
+
+/* Fold LEN bytes at P into the checksum H, one 8-byte word at a time.
+   A trailing partial word is padded, so the result depends on where the
+   calls split the data: both sides must fold it in the same pieces.  */
+static uint64_t
+checksum (uint64_t h, const void *p, size_t len)
+{
+    const unsigned char *c = p;
+    uint64_t w;
+
+    for (; len >= 8; c += 8, len -= 8) {
+        memcpy (&w, c, 8);
+        h = (h ^ w) * CHECKSUM_PRIME;
+        h ^= h >> 29;
+    }
+    if (len > 0) {
+        w = 0;
+        memcpy (&w, c, len);
+        h = (h ^ w ^ ((uint64_t) len << 56)) * CHECKSUM_PRIME;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+static int
+checksum_file (const char *path, uint64_t *sum)
+{
+    static char buffer[1 << 20];
+    uint64_t h = CHECKSUM_SEED;
+    size_t len;
+    FILE *f = fopen (path, "rb");
+
+    if (f == NULL)
+        return -1;
+    while ((len = fread (buffer, 1, sizeof(buffer), f)) > 0)
+        h = checksum (h, buffer, len);
+    if (ferror (f)) {
+        fclose (f);
+        return -1;
+    }
+    fclose (f);
+    *sum = h;
+    return 0;
+}
+
+static uint64_t
+checksum_payload (const ghss_index_t *cumsizes, int nsets, const double *data,
+                  const ghss_index_t *perm, size_t ncoords)
+{
+    uint64_t h = CHECKSUM_SEED;
+
+    h = checksum (h, cumsizes, nsets * sizeof(ghss_index_t));
+    h = checksum (h, data, ncoords * sizeof(double));
+    if (perm)
+        h = checksum (h, perm, ncoords * sizeof(ghss_index_t));
+    return h;
+}
+
+static uint32_t
+cache_flags (bool union_sets)
+{
+    return (union_sets ? CACHE_UNION : 0) | (sizeof(ghss_index_t) > 4 ? CACHE_LARGE : 0);
+}
+
+static bool
+has_order (int nobj)
+{
+    return nobj == 2 || nobj == 3;
+}
+
+
+
+bool
+cache_load (const char *path, const char *source, bool union_sets,
+            arena_t *arena, double **data_p, int *nobj_p,
+            ghss_index_t **cumsizes_p, int *nsets_p, ghss_index_t **perm_p)
+{
+    cache_header_t h;
+    struct stat st;
+    uint64_t sum;
+    size_t ncoords;
+    double *data = NULL;
+    ghss_index_t *cumsizes = NULL, *perm = NULL;
+    FILE *f;
+
+    if (stat (source, &st) != 0 || (f = fopen (path, "rb")) == NULL)
+        return false;
+
+    if (fread (&h, sizeof(h), 1, f) != 1
+        || memcmp (h.magic, CACHE_MAGIC, sizeof(h.magic)) != 0
+        || h.version != CACHE_VERSION
+        || h.byteorder != CACHE_BYTEORDER
+        || h.coordsize != CACHE_COORDSIZE
+        || h.flags != cache_flags (union_sets)
+        || h.size != (uint64_t) st.st_size
+        || h.mtime_sec != (int64_t) st.st_mtim.tv_sec
+        || h.mtime_nsec != (int64_t) st.st_mtim.tv_nsec
+        || h.nobj < 1 || (*nobj_p != 0 && h.nobj != *nobj_p)
+        || h.nsets < 1 || h.npoints > (uint64_t) GHSS_INDEX_MAX
+        || checksum_file (source, &sum) != 0 || sum != h.checksum)
+        goto stale;
+
+    ncoords = (size_t) h.npoints * h.nobj;
+    cumsizes = malloc (h.nsets * sizeof(ghss_index_t));
+    data = arena_alloc (arena, ncoords * sizeof(double));
+    if (has_order (h.nobj))
+        perm = malloc (ncoords * sizeof(ghss_index_t));
+    if (cumsizes == NULL || data == NULL || (has_order (h.nobj) && perm == NULL))
+        goto stale;
+
+    if (fread (cumsizes, sizeof(ghss_index_t), h.nsets, f) != (size_t) h.nsets
+        || fread (data, sizeof(double), ncoords, f) != ncoords
+        || (perm && fread (perm, sizeof(ghss_index_t), ncoords, f) != ncoords)
+        || fgetc (f) != EOF
+        || cumsizes[h.nsets - 1] != (ghss_index_t) h.npoints
+        || checksum_payload (cumsizes, h.nsets, data, perm, ncoords) != h.payload)
+        goto stale;
+
+    fclose (f);
+    *data_p = data;
+    *nobj_p = h.nobj;
+    *cumsizes_p = cumsizes;
+    *nsets_p = h.nsets;
+    *perm_p = perm;
+    return true;
+
+stale:
+    fclose (f);
+    arena_free (arena, data);
+    free (cumsizes);
+    free (perm);
+    return false;
+}
+
+
+
+int
+cache_save (const char *path, const char *source, const struct stat *st,
+            bool union_sets, const double *data, int nobj,
+            const ghss_index_t *cumsizes, int nsets, const ghss_index_t *perm)
+{
+    cache_header_t h;
+    size_t ncoords = (size_t) cumsizes[nsets - 1] * nobj;
+    size_t len = strlen (path);
+    char *tmp;
+    FILE *f;
+    int err;
+
+    memset (&h, 0, sizeof(h));
+    memcpy (h.magic, CACHE_MAGIC, sizeof(h.magic));
+    h.version = CACHE_VERSION;
+    h.byteorder = CACHE_BYTEORDER;
+    h.coordsize = CACHE_COORDSIZE;
+    h.flags = cache_flags (union_sets);
+    h.size = st->st_size;
+    h.mtime_sec = st->st_mtim.tv_sec;
+    h.mtime_nsec = st->st_mtim.tv_nsec;
+    if (checksum_file (source, &h.checksum) != 0)
+        return -1;
+    h.nobj = nobj;
+    h.nsets = nsets;
+    h.npoints = cumsizes[nsets - 1];
+    if (!has_order (nobj))
+        perm = NULL;
+    h.payload = checksum_payload (cumsizes, nsets, data, perm, ncoords);
+
+    tmp = malloc (len + sizeof(".tmp"));
+    if (tmp == NULL)
+        return -1;
+    memcpy (tmp, path, len);
+    memcpy (tmp + len, ".tmp", sizeof(".tmp"));
+
+    if ((f = fopen (tmp, "wb")) == NULL) {
+        free (tmp);
+        return -1;
+    }
+    if (fwrite (&h, sizeof(h), 1, f) != 1
+        || fwrite (cumsizes, sizeof(ghss_index_t), nsets, f) != (size_t) nsets
+        || fwrite (data, sizeof(double), ncoords, f) != ncoords
+        || (perm && fwrite (perm, sizeof(ghss_index_t), ncoords, f) != ncoords)) {
+        err = errno;
+        fclose (f);
+        goto fail;
+    }
+    if (fclose (f) != 0 || rename (tmp, path) != 0) {
+        err = errno;
+        goto fail;
+    }
+    free (tmp);
+    return 0;
+
+fail:
+    remove (tmp);
+    free (tmp);
+    errno = err;
+    return -1;
+}
@@ -0,0 +1,61 @@
+/*************************************************************************
+
+ cache.h
+
+ ---------------------------------------------------------------------
+
+                       Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+
+
+*************************************************************************/
+#ifndef GHSS_CACHE_H_
+#define GHSS_CACHE_H_
+
+#include <stdbool.h>
+#include <sys/stat.h>
+
+#include "arena.h"
+#include "gHSS.h"
+
+/* Load the points of SOURCE (as read_data would) and their order along
+   each dimension in each set (as given by greedyhss_sort, in *PERM_P,
+   NULL if the dimension is not 2 or 3) from the sidecar file PATH. UNION
+   tells whether the sets were merged into one when the orders were
+   saved. The points are allocated in ARENA, *CUMSIZES_P and *PERM_P with
+   malloc. If *NOBJ_P is not 0, it must match the dimension of the
+   points. Returns true, or false (changing nothing) if PATH is missing,
+   does not match SOURCE, which must have the size, modification time and
+   checksum it had when PATH was saved, or is not complete.  */
+bool cache_load (const char *path, const char *source, bool union_sets,
+                 arena_t *arena, double **data_p, int *nobj_p,
+                 ghss_index_t **cumsizes_p, int *nsets_p, ghss_index_t **perm_p);
+
+/* Save the points read from SOURCE, and their order (PERM, may be NULL),
+   to the sidecar file PATH. ST is the status of SOURCE before it was
+   read, so that a change made while reading it makes the sidecar stale.
+   Returns 0, or -1 (with errno set) if PATH could not be written.  */
+int cache_save (const char *path, const char *source, const struct stat *st,
+                bool union_sets, const double *data, int nobj,
+                const ghss_index_t *cumsizes, int nsets, const ghss_index_t *perm);
+
+#endif
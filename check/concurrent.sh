@@ -0,0 +1,54 @@
+#!/bin/sh
+# Checks that the three updateOut sweeps done concurrently (-t 3) select the same points, with
+# the same contributions, as the serial order (-t 1), byte for byte. GHSS is a gHSS built with
+# -D CONCURRENT_MIN_N=1 (make check builds check/gHSS-concurrent), so that the sweeps are done
+# concurrently for inputs this small.
+#
+# usage: concurrent.sh GHSS
+
+GHSS=${1:?usage: $0 GHSS}
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+
+# gen NAME N SEED KIND: N points in 3D, in [0,1)^3 (cloud), on the sphere of radius 1 (front)
+# or on a grid of 8 values per axis, with repeated points and ties (grid)
+gen () {
+    awk -v n="$2" -v seed="$3" -v kind="$4" 'BEGIN {
+        srand(seed);
+        for (i = 0; i < n; i++) {
+            if (kind == "grid") {
+                x = int(rand() * 8) / 8; y = int(rand() * 8) / 8; z = int(rand() * 8) / 8;
+            } else if (kind == "front") {
+                x = rand(); y = rand(); z = rand();
+                r = sqrt(x * x + y * y + z * z) + 1e-9;
+                x /= r; y /= r; z /= r;
+            } else {
+                x = rand(); y = rand(); z = rand();
+            }
+            printf "%.17g %.17g %.17g\n", x, y, z;
+        }
+    }' > "$TMP/$1"
+}
+
+gen cloud 1500 1 cloud
+gen front 1500 2 front
+gen grid 600 3 grid
+gen small 20 4 cloud
+
+failed=0
+total=0
+for f in cloud front grid small; do
+    for k in 1 10 200 MAX; do
+        for fmt in 3 6; do
+            total=$((total + 1))
+            "$GHSS" -q -e list -f $fmt -k $k -r "1.1 1.1 1.1" -t 1 "$TMP/$f" > "$TMP/serial"
+            "$GHSS" -q -e list -f $fmt -k $k -r "1.1 1.1 1.1" -t 3 "$TMP/$f" > "$TMP/concurrent"
+            if ! cmp -s "$TMP/serial" "$TMP/concurrent"; then
+                echo "FAIL: $f -k $k -f $fmt: -t 3 differs from -t 1"
+                failed=$((failed + 1))
+            fi
+        done
+    done
+done
+echo "concurrent.sh: $failed of $total cases failed"
+test $failed -eq 0
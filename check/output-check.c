@@ -0,0 +1,118 @@
+/*************************************************************************
+
+ output-check: doubles written by output_double
+
+ ---------------------------------------------------------------------
+
+                        Copyright (c) 2015-2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+ ----------------------------------------------------------------------
+
+ Each double is given by its bits, so that it is not folded by the
+ compiler (the checks are built with the flags of gHSS, which include
+ -ffast-math), and is written with output_double, with 15 digits and
+ with the shortest digits. The text written is compared with the text
+ expected, which is the one of fprintf with "%.15g" and "%.17g" except
+ for the shortest digits. Prints one line per case that fails and
+ exits with status 1 if any does.
+
+*************************************************************************/
+#include "../output.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct check_case {
+    uint64_t bits;
+    const char *g15;            /* text of "%.15g" */
+    const char *shortest;       /* shortest digits */
+} check_case_t;
+
+static const check_case_t cases[] = {
+    { UINT64_C(0x7ff0000000000000), "inf", "inf" },
+    { UINT64_C(0xfff0000000000000), "-inf", "-inf" },
+    { UINT64_C(0x7ff8000000000000), "nan", "nan" },
+    { UINT64_C(0xfff8000000000000), "-nan", "-nan" },
+    { UINT64_C(0x8000000000000000), "-0", "-0" },
+    { UINT64_C(0x0000000000000000), "0", "0" },
+    { UINT64_C(0x3fb999999999999a), "0.1", "0.1" },          /* 0.1 */
+    { UINT64_C(0xbfd0000000000000), "-0.25", "-0.25" },      /* -0.25 */
+    { UINT64_C(0x7fefffffffffffff), "1.79769313486232e+308",
+      "1.7976931348623157e+308" },                           /* DBL_MAX */
+    { UINT64_C(0x0000000000000001), "4.94065645841247e-324",
+      "5e-324" },                                            /* subnormal */
+};
+
+/* the text written for X, without the padding */
+static const char *
+format (double x, bool shortest)
+{
+    static char text[64];
+    FILE *f = tmpfile ();
+    output_t *o;
+    size_t len;
+
+    if (f == NULL || (o = output_new (f, shortest)) == NULL) {
+        perror ("output-check");
+        exit (EXIT_FAILURE);
+    }
+    output_double (o, x);
+    output_flush (o);
+    output_delete (o);
+    rewind (f);
+    len = fread (text, 1, sizeof(text) - 1, f);
+    fclose (f);
+    while (len > 0 && text[len - 1] == ' ')
+        len--;
+    text[len] = '\0';
+    return text;
+}
+
+static int
+check (double x, bool shortest, const char *expected)
+{
+    const char *text = format (x, shortest);
+
+    if (strcmp (text, expected) == 0)
+        return 0;
+    printf ("FAIL: %s: '%s' instead of '%s'\n",
+            (shortest) ? "shortest" : "%.15g", text, expected);
+    return 1;
+}
+
+int
+main (void)
+{
+    size_t i;
+    int failed = 0;
+    double x;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        memcpy (&x, &cases[i].bits, sizeof(x));
+        failed += check (x, false, cases[i].g15);
+        failed += check (x, true, cases[i].shortest);
+    }
+    printf ("output-check: %d of %d cases failed\n", failed,
+            (int) (2 * sizeof(cases) / sizeof(cases[0])));
+    return (failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -35,29 +35,296 @@
 *************************************************************************/
 
 #include "gHSS.h"
+#include "argmax.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
 #include <float.h>
 #include <math.h>
+#include <string.h>
+#include <stdint.h>
 
+#if GHSS_THREADS
+#include <pthread.h>
+#endif
+
+#include <stddef.h>
+#include <time.h>
 
 #if __GNUC__ >= 3
 # define __ghss_unused    __attribute__ ((unused))
+# define ghss_prefetch(p) __builtin_prefetch (p)
 #else
 # define __ghss_unused    /* no 'unused' attribute available */
+# define ghss_prefetch(p) ((void) (p))
+#endif
+
+/*
+ * Type of the coordinates kept by gHSS (make PRECISION=float keeps them in single precision, the
+ * input is rounded once when it is copied). Areas and contributions are always double.
+ */
+#if GHSS_FLOAT
+typedef float coord_t;
+# define COORD_MAX FLT_MAX
+#else
+typedef double coord_t;
+# define COORD_MAX DBL_MAX
 #endif
 
 
 FILE * infoFile;
 
 
+
+/* ------------------------------------------ Stats ----------------------------------------------*/
+
+/*
+ * With GHSS_STATS, each thread counts in its own copy of the counters (tstats), which is added
+ * to 'stats' when the thread is done. Otherwise the STATS_* macros expand to nothing.
+ */
+#if GHSS_STATS
+
+static __thread ghss_stats_t tstats;
+static ghss_stats_t stats;
+
+static long long statsNow(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static void statsEndIteration(long long start){
+    long long ns = statsNow() - start;
+    int b = 0;
+    while(b < GHSS_STATS_BUCKETS - 1 && (2LL << b) <= ns) b++;
+    tstats.latency[b]++;
+    tstats.iterations++;
+}
+
+/* add the counters of this thread to 'stats' (the caller makes sure no other thread does it) */
+static void statsMerge(void){
+    unsigned long long * from = (unsigned long long *) &tstats;
+    unsigned long long * to = (unsigned long long *) &stats;
+    size_t i;
+    for(i = 0; i < sizeof(ghss_stats_t) / sizeof(unsigned long long); i++)
+        to[i] += from[i];
+    memset(&tstats, 0, sizeof(tstats));
+}
+
+# define STATS_ADD(field, v)        (tstats.field += (v))
+# define STATS_BEGIN_ITERATION()    long long stats_t0 = statsNow()
+# define STATS_END_ITERATION()      statsEndIteration(stats_t0)
+
+#else
+
+# define STATS_ADD(field, v)        ((void) 0)
+# define STATS_BEGIN_ITERATION()    ((void) 0)
+# define STATS_END_ITERATION()      ((void) 0)
+
+#endif
+
+
+int gHSS_get_stats(ghss_stats_t * s){
+#if GHSS_STATS
+    *s = stats;
+    return 1;
+#else
+    memset(s, 0, sizeof(*s));
+    return 0;
+#endif
+}
+
+
+
+/* ------------------------------------------ Timings --------------------------------------------*/
+
+/*
+ * greedyhss saves the time at which it starts and ends and each algorithm calls setupDone()
+ * just before its first selection (only the first call counts).
+ */
+static ghss_timings_t timings;
+static struct timespec setupMark[2];
+static int setupMarked;
+
+static double elapsed(const struct timespec * from, const struct timespec * to){
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) * 1.0E-9;
+}
+
+static void setupDone(void){
+    if(setupMarked) return;
+    clock_gettime(CLOCK_MONOTONIC, &setupMark[0]);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &setupMark[1]);
+    setupMarked = 1;
+}
+
+
+void gHSS_get_timings(ghss_timings_t * t){
+    *t = timings;
+}
+
+
+
+/* ------------------------------------------ Memory ---------------------------------------------*/
+
+/*
+ * Everything greedyhss allocates comes from the arena of the call, which is released when the
+ * call returns (or, with GHSS_ARENA_REUSE, kept by the thread for its next call).
+ */
+static int arenaFlags = 0;
+static __thread arena_t * callArena;
+static __thread arena_t * keptArena;
+
+void gHSS_set_arena(int flags){
+    arenaFlags = flags;
+    if(!(flags & GHSS_ARENA_REUSE) && keptArena){
+        arena_delete(keptArena);
+        keptArena = NULL;
+    }
+}
+
+// 'size' is an estimate of the memory the call needs
+static void beginArena(size_t size){
+    if(keptArena && (arenaFlags & GHSS_ARENA_REUSE)){
+        callArena = keptArena;
+    }else{
+        arena_delete(keptArena);
+        callArena = arena_new(size, (arenaFlags & GHSS_ARENA_PREFAULT) ? ARENA_PREFAULT : 0);
+    }
+    keptArena = NULL;
+}
+
+static void endArena(void){
+    if(arenaFlags & GHSS_ARENA_REUSE){
+        arena_reset(callArena);
+        keptArena = callArena;
+    }else{
+        arena_delete(callArena);
+    }
+    callArena = NULL;
+}
+
+static inline void * ghssMalloc(size_t size){
+    return arena_alloc(callArena, size);
+}
+
+static inline void * ghssCalloc(size_t nmemb, size_t size){
+    return arena_calloc(callArena, nmemb, size);
+}
+
+static inline void ghssFree(void * p){
+    arena_free(callArena, p);
+}
+
+
+
 /* ------------------------------------ Data structure ------------------------------------------*/
 
+/*
+ * Set of positions between 0 and m-1 (e.g., of the selected points in the chain of the 2D tree
+ * engine, or of the ranks of the points selected in 3D along an axis), as a tree of 64-bit words
+ * in which each bit of a level tells whether the corresponding word of the level below is not
+ * empty.
+ */
+typedef struct posset {
+    int nlevels;
+    ghss_index_t nwords[6];
+    unsigned long long * level[6];
+} posset_t;
+
+
+
+static void setupPosset(posset_t * s, ghss_index_t m){
+
+    int lv = 0;
+    ghss_index_t nbits = m;
+    do{
+        s->nwords[lv] = (nbits + 63) / 64;
+        s->level[lv] = ghssCalloc(s->nwords[lv], sizeof(unsigned long long));
+        nbits = s->nwords[lv++];
+    }while(nbits > 1);
+    s->nlevels = lv;
+}
+
+
+
+static void freePosset(posset_t * s){
+    int lv;
+    for(lv = 0; lv < s->nlevels; lv++)
+        ghssFree(s->level[lv]);
+}
+
+
+
+static void possetInsert(posset_t * s, ghss_index_t j){
+
+    int lv;
+    for(lv = 0; lv < s->nlevels; lv++){
+        unsigned long long w = s->level[lv][j / 64];
+        s->level[lv][j / 64] = w | (1ULL << (j % 64));
+        if(w) break;
+        j /= 64;
+    }
+}
+
+
+
+/* largest position in 's' smaller than j (-1 if none) */
+static ghss_index_t possetPrev(const posset_t * s, ghss_index_t j){
+
+    int lv;
+    unsigned long long w;
+
+    for(lv = 0; lv < s->nlevels; lv++, j /= 64){
+        w = s->level[lv][j / 64] & ((1ULL << (j % 64)) - 1);
+        if(w){
+            j = (j / 64) * 64 + 63 - __builtin_clzll(w);
+            break;
+        }
+    }
+    if(lv == s->nlevels)
+        return -1;
+    while(lv-- > 0)
+        j = j * 64 + 63 - __builtin_clzll(s->level[lv][j]);
+    return j;
+}
+
+
+
+/* smallest position in 's' larger than j (-1 if none) */
+static ghss_index_t possetNext(const posset_t * s, ghss_index_t j){
+
+    int lv;
+    unsigned long long w;
+
+    for(lv = 0, j++; lv < s->nlevels; lv++, j = j / 64 + 1){
+        if(j / 64 >= s->nwords[lv])
+            return -1;
+        w = s->level[lv][j / 64] & (~0ULL << (j % 64));
+        if(w){
+            j = (j / 64) * 64 + __builtin_ctzll(w);
+            break;
+        }
+    }
+    if(lv == s->nlevels)
+        return -1;
+    while(lv-- > 0)
+        j = j * 64 + __builtin_ctzll(s->level[lv][j]);
+    return j;
+}
+
+
+
+/*
+ * The three flags of a node are bytes that fill the padding after the coordinates (which the
+ * sweeps read together with them), so that a node is as large with the 64-bit ids of a
+ * GHSS_LARGE build as with int ids (176 bytes with double coordinates).
+ */
 typedef struct dlnode {
-  double x[3];          // Point
-  int in;               //True or False - indicates whether the points has been selected (True) or if still left out (False)
-  int updated;          //if in == False, then 'updated' indicates whether the contribution of this points was already updated
+  coord_t x[3];         // Point
+  unsigned char in;     //True or False - indicates whether the points has been selected (True) or if still left out (False)
+  unsigned char updated;//if in == False, then 'updated' indicates whether the contribution of this points was already updated
+  unsigned char dom;    //is this a dominated point?
  
  //current next (for a list of 'in' points that is modified along the execution)
   struct dlnode * cnext[2]; 
@@ -76,22 +343,39 @@ typedef struct dlnode {
   double oldcontrib;    //temporary (save last contribution)
   double lastSlicez;    // up to which value of z the contribution is computed
   struct dlnode * replaced; //the point this one replaced (prev in the paper)
-  int dom; //is this a dominated point?
-  int id;
+  ghss_index_t id;      // index of the point (-1 and -2 in the sentinels)
   
 } dlnode_t;
 
 
+/*
+ * State of one updateOut sweep. In the serial case there is a single sweep_t for 'list' and
+ * the three sweeps are done one after the other. When the sweeps are done concurrently (see
+ * setupSweepPool), each one works on its own copy of the list (a view, see setupView) in which
+ * the coordinates are rotated, so that all three are done in order (x,y,z).
+ */
+typedef struct sweep {
+    dlnode_t * list;        // list of all points (or a view of it)
+    int nprior;             // number of sweeps that precede this one in the serial order
+    int prior[2][3];        // (xi,yi,zi) of those sweeps, in the coordinates of this view
+    dlnode_t ** touched;    // 'out' points whose contribution was changed by this sweep
+    ghss_index_t ntouched;
+    const ghss_index_t * rank[3]; // rank[j][i]: position of point list+1+i along axis j (see setupRanks)
+    const ghss_index_t * order[3];// order[j][r]: the point of rank r along axis j is list+1+order[j][r]
+    const posset_t * in[3];       // ranks along axis j of the points selected
+} sweep_t;
+
+
 
 
 /* ------------------------------------ Print functions ------------------------------------------*/
 
 #if VARIANT < 2
-static void printPoint(double * x, int d){
+static void printPoint(coord_t * x, int d){
  
     int i;
     for(i = 0; i < d; i++){
-        if(x[i] == -DBL_MAX){
+        if(x[i] == -COORD_MAX){
            fprintf(infoFile, "-inf\t");
         }else{
             fprintf(infoFile, "%.2f\t", x[i]);
@@ -195,10 +479,19 @@ static void printAllContrib(dlnode_t * list, int ix){
 /* -------------------------------------- Setup Data ---------------------------------------------*/
 
 
-static void copyPoint(double * source, double * dest, int d){
-    int i;
-    for(i = 0; i < d; i++)
-        dest[i] = source[i];
+/*
+ * The points as given by the caller: coordinate j of point i is the double at
+ * base + i * rowstride + j * colstride (strides in bytes), so that they are read in place.
+ */
+typedef struct points {
+    const char * base;
+    ptrdiff_t rowstride;
+    ptrdiff_t colstride;
+} points_t;
+
+
+static inline double coord(const points_t * pts, ghss_index_t i, int j){
+    return *(const double *) (pts->base + i * pts->rowstride + j * pts->colstride);
 }
 
 
@@ -232,19 +525,186 @@ static int compare_node3d(const void *p1, const void* p2)
 
 
 
+/*
+ * Link the points in scratch[0], ..., scratch[n-1], in this order, in the circular list of
+ * dimension j (between the two sentinels).
+ */
+static void linkAxis(dlnode_t * head, dlnode_t ** scratch, ghss_index_t n, int j){
+
+    ghss_index_t i;
+
+    head->next[j] = scratch[0];
+    scratch[0]->prev[j] = head;
+    for (i = 1; i < n; i++) {
+        scratch[i-1]->next[j] = scratch[i];
+        scratch[i]->prev[j] = scratch[i-1];
+    }
+//     scratch[n-1]->next[j] = head;
+//     head->prev[j] = scratch[n-1];
+    scratch[n-1]->next[j] = head+n+1;
+    (head+n+1)->prev[j] = scratch[n-1];
+    (head+n+1)->next[j] = head;
+    head->prev[j] = (head+n+1);
+}
+
+
+
+/* ------------------------------------ Layout of the nodes ------------------------------------*/
+
+static int layout = GHSS_LAYOUT_INPUT;
+
+void gHSS_set_layout(int l){
+    layout = l;
+}
+
+
+typedef struct zkey {
+    uint64_t code;      // Morton code of the ranks of the point
+    ghss_index_t slot;  // position of its node (minus 1)
+} zkey_t;
+
+static int compare_zkey(const void *p1, const void* p2)
+{
+    const zkey_t * a = p1;
+    const zkey_t * b = p2;
+
+    if (a->code != b->code) return (a->code < b->code) ? -1 : 1;
+    return (a->slot < b->slot) ? -1 : (a->slot > b->slot);
+}
+
+// the lowest 32 bits of x, with a zero bit after each one
+static uint64_t spreadBits2(uint64_t x){
+    x &= 0xffffffffULL;
+    x = (x | x << 16) & 0x0000ffff0000ffffULL;
+    x = (x | x << 8)  & 0x00ff00ff00ff00ffULL;
+    x = (x | x << 4)  & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | x << 2)  & 0x3333333333333333ULL;
+    x = (x | x << 1)  & 0x5555555555555555ULL;
+    return x;
+}
+
+// the lowest 21 bits of x, with two zero bits after each one
+static uint64_t spreadBits3(uint64_t x){
+    x &= 0x1fffffULL;
+    x = (x | x << 32) & 0x001f00000000ffffULL;
+    x = (x | x << 16) & 0x001f0000ff0000ffULL;
+    x = (x | x << 8)  & 0x100f00f00f00f00fULL;
+    x = (x | x << 4)  & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2)  & 0x1249249249249249ULL;
+    return x;
+}
+
+/*
+ * Position (minus 1) that the node of each point will take in the layout: along the last axis,
+ * or in the Z-order of the ranks of the points along the axes (reduced to the bits that fit in
+ * a 64-bit code when there are more than 2^21 points in 3D).
+ */
+static void layoutOrder(dlnode_t * head, int d, ghss_index_t n, ghss_index_t * dest){
+
+    ghss_index_t i, rank;
+    dlnode_t * q;
+    zkey_t * keys;
+    int j, shift = 0;
+
+    if (layout == GHSS_LAYOUT_AXIS) {
+        for (q = head->next[d-1], rank = 0; q != head->prev[d-1]; q = q->next[d-1])
+            dest[q - head - 1] = rank++;
+        return;
+    }
+
+    while (((uint64_t) (n - 1) >> shift) >> ((d == 2) ? 32 : 21))
+        shift++;
+    keys = ghssMalloc(n * sizeof(zkey_t));
+    for (i = 0; i < n; i++) {
+        keys[i].code = 0;
+        keys[i].slot = i;
+    }
+    for (j = 0; j < d; j++) {
+        for (q = head->next[j], rank = 0; q != head->prev[j]; q = q->next[j], rank++) {
+            uint64_t r = (uint64_t) rank >> shift;
+            keys[q - head - 1].code |= ((d == 2) ? spreadBits2(r) : spreadBits3(r)) << j;
+        }
+    }
+    qsort(keys, n, sizeof(zkey_t), compare_zkey);
+    for (i = 0; i < n; i++)
+        dest[keys[i].slot] = i;
+    ghssFree(keys);
+}
+
+static inline dlnode_t * movedNode(dlnode_t * head, ghss_index_t n, const ghss_index_t * dest, dlnode_t * p){
+    return (p == head || p == head+n+1) ? p : head + 1 + dest[p - head - 1];
+}
+
+/*
+ * Move the nodes of the points (not the sentinels) of the lists set up by setup_cdllist to the
+ * order of 'layout', so that the sweeps, which follow the lists, find the next node close to the
+ * current one. 'dest' is scratch space for n indices. The ids of the points are kept.
+ */
+static void renumberList(dlnode_t * head, int d, ghss_index_t n, ghss_index_t * dest){
+
+    ghss_index_t i, j;
+    dlnode_t tmp;
+    int l;
+
+    layoutOrder(head, d, n, dest);
+
+    // the links first, while 'dest' still maps each position to the new one
+    for (i = 0; i < n+2; i++) {
+        for (l = 0; l < d; l++) {
+            head[i].next[l] = movedNode(head, n, dest, head[i].next[l]);
+            head[i].prev[l] = movedNode(head, n, dest, head[i].prev[l]);
+        }
+    }
+    // then the nodes, one cycle of the permutation at a time
+    for (i = 0; i < n; i++) {
+        while (dest[i] != i) {
+            j = dest[i];
+            tmp = head[1+j];
+            head[1+j] = head[1+i];
+            head[1+i] = tmp;
+            dest[i] = dest[j];
+            dest[j] = j;
+        }
+    }
+}
+
+/*
+ * Ids of the points in the order of their nodes (so that ties in the contributions are broken
+ * by id, see maximumOutContributor), or NULL if the nodes are in the order of the input.
+ */
+static ghss_index_t * nodeKeys(const dlnode_t * list, ghss_index_t n){
+
+    ghss_index_t i, * key;
+
+    for (i = 0; i < n && list[i+1].id == i; i++);
+    if (i == n)
+        return NULL;
+    key = ghssMalloc(n * sizeof(ghss_index_t));
+    for (i = 0; i < n; i++)
+        key[i] = list[i+1].id;
+    return key;
+}
+
+
+
 /*
  * Setup circular double-linked list in each dimension (with two sentinels).
  * Initialize data.
+ *
+ * The points are sorted along each dimension, unless 'perm' is not NULL, in which case
+ * perm[j*n], ..., perm[j*n + n-1] is their order along dimension j, as given by greedyhss_sort,
+ * and the lists are linked in linear time.
  */
 
 static dlnode_t *
-setup_cdllist(double *data, int d, int n)
+setup_cdllist(const points_t *pts, int d, ghss_index_t n, const ghss_index_t * perm)
 {
     dlnode_t *head;
     dlnode_t **scratch;
-    int i, j;
+    ghss_index_t i;
+    int j;
 
-    head  = malloc ((n+2) * sizeof(dlnode_t));
+    head  = ghssMalloc((n+2) * sizeof(dlnode_t));
     head[0].id = -1;
     head[0].in = 1;
     head[0].area = 0; head[0].contrib = 0; head[0].oldcontrib = 0; head[0].lastSlicez = 0;
@@ -261,7 +721,8 @@ setup_cdllist(double *data, int d, int n)
 
     for (i = 1; i <= n; i++) {
 //         head[i].x = head[i-1].x + d ;/* this will be fixed a few lines below... */
-        copyPoint(&(data[(i-1)*d]), head[i].x, d);
+        for (j = 0; j < d; j++)
+            head[i].x[j] = coord(pts, i-1, j);
         head[i].area = 0;
         head[i].contrib = 0;
         head[i].oldcontrib = 0;
@@ -272,7 +733,20 @@ setup_cdllist(double *data, int d, int n)
         head[i].dom = 0;
     }
 
-    scratch = malloc(n * sizeof(dlnode_t*));
+    scratch = ghssMalloc(n * sizeof(dlnode_t*));
+
+    if (perm) {
+        for (j = d-1; j >= 0; j--) {
+            for (i = 0; i < n; i++)
+                scratch[i] = head + perm[j*n + i] + 1;
+            linkAxis(head, scratch, n, j);
+        }
+        if (layout != GHSS_LAYOUT_INPUT)
+            renumberList(head, d, n, (ghss_index_t *) scratch);
+        ghssFree(scratch);
+        return head;
+    }
+
     for (i = 0; i < n; i++)
         scratch[i] = head + i + 1;
 
@@ -280,21 +754,12 @@ setup_cdllist(double *data, int d, int n)
         if(j == 2) qsort(scratch, n, sizeof(dlnode_t*), compare_node3d);
         else if(j == 1) qsort(scratch, n, sizeof(dlnode_t*), compare_node2d);
         else qsort(scratch, n, sizeof(dlnode_t*), compare_node);
-        head->next[j] = scratch[0];
-        scratch[0]->prev[j] = head;
-        for (i = 1; i < n; i++) {
-            scratch[i-1]->next[j] = scratch[i];
-            scratch[i]->prev[j] = scratch[i-1];
-        }
-//         scratch[n-1]->next[j] = head;
-//         head->prev[j] = scratch[n-1];
-        scratch[n-1]->next[j] = head+n+1;
-        (head+n+1)->prev[j] = scratch[n-1];
-        (head+n+1)->next[j] = head;
-        head->prev[j] = (head+n+1);
+        linkAxis(head, scratch, n, j);
     }
 
-    free(scratch);
+    if (layout != GHSS_LAYOUT_INPUT)
+        renumberList(head, d, n, (ghss_index_t *) scratch);
+    ghssFree(scratch);
 
     return head;
 }
@@ -334,24 +799,139 @@ static void updateVolume(dlnode_t * p, double z){
 
 
 /*
- * Find maximum contributor and, since all points are visited, also set the
- * 'updated' flag of all points to false as they may have to be updated
+ * Check whether the 'out' point q is to be updated by sweep 'sw' or whether it was left to
+ * one of the sweeps that precede it in the serial order (ties are resolved in favour of the
+ * sweep that comes first). Only used when the three sweeps are done concurrently, in the serial
+ * case this is what the 'updated' flag does.
  */
-static dlnode_t * maximumOutContributor(dlnode_t * list){
+static inline int isOwned(const sweep_t * sw, const dlnode_t * q, const dlnode_t * p){
+    
+    int i;
+    if(q->x[0] >= p->x[0] && q->x[1] >= p->x[1] && q->x[2] >= p->x[2])
+        return 1;   // marking q as dominated by p may be done by any of the sweeps
+    
+    for(i = 0; i < sw->nprior; i++){
+        const int * a = sw->prior[i];
+        if(q->x[a[0]] >= p->x[a[0]] && q->x[a[1]] >= p->x[a[1]])
+            return 0;
+        if(q->x[a[0]] <= p->x[a[0]] && q->x[a[1]] <= p->x[a[1]] && q->x[a[2]] >= p->x[a[2]])
+            return 0;
+    }
+    return 1;
+}
 
-    double c = -DBL_MAX;
-    dlnode_t * maxp = list;
-    dlnode_t * p = list->next[0];
-    dlnode_t * stop = list->prev[0];
-    while(p != stop){
-        p->updated = 0;
-        if(!p->in && ((p->contrib > c) || (p->contrib == c && p->id < maxp->id))){
-            c = p->contrib;
-            maxp = p;
+
+
+/*
+ * Find maximum contributor. 'cv' holds the contribution of every point (cv[i] is the contribution
+ * of point list+1+i), except for the points already selected which are set to ARGMAX_MASKED.
+ * In case of ties the point with the lowest id is returned: 'key' holds the ids of the points in
+ * the order of 'cv', or is NULL if they are in the order of the input (see nodeKeys).
+ */
+static inline dlnode_t * maximumOutContributor(dlnode_t * list, const double * cv, const ghss_index_t * key,
+                                               ghss_index_t n){
+    
+    STATS_ADD(argmax_calls, 1);
+    STATS_ADD(argmax_entries, n);
+    return list + 1 + (key ? argmax_key(cv, key, n) : argmax(cv, n));
+}
+
+
+
+/*
+ * An 'out' point that is dominated (dom) is only skipped by the sweeps, so in 3D it is unlinked
+ * from the three sorted lists once the iteration in which it was found to be dominated is done,
+ * and the later sweeps do not visit it. Its own links are kept. It is linked again if it is
+ * selected (which only happens when no point left has a positive contribution), since the
+ * points selected take part in the sweeps even if they are dominated. The position it had in
+ * each list is found from the rank of the points along each axis, as sorted by setup_cdllist.
+ */
+static ghss_index_t * setupRanks(dlnode_t * list, ghss_index_t n){
+    
+    ghss_index_t * rank = ghssMalloc(6 * n * sizeof(ghss_index_t));    // followed by the inverse (order)
+    ghss_index_t r;
+    dlnode_t * q;
+    int j;
+    
+    for(j = 0; j < 3; j++){
+        for(q = list->next[j], r = 0; q != list->prev[j]; q = q->next[j], r++){
+            rank[j * n + (q - list - 1)] = r;
+            rank[(3 + j) * n + r] = q - list - 1;
         }
-        p = p->next[0];
     }
-    return maxp;
+    return rank;
+}
+
+static inline int isLinked(const dlnode_t * q){
+    return q->prev[0]->next[0] == q;
+}
+
+static void unlinkNode(dlnode_t * q){
+    
+    int j;
+    STATS_ADD(unlinked, 1);
+    for(j = 0; j < 3; j++){
+        q->prev[j]->next[j] = q->next[j];
+        q->next[j]->prev[j] = q->prev[j];
+    }
+}
+
+/*
+ * Link q again in the lists of sw->list. Its links lead back, through points that were unlinked
+ * after it, to a point that is still linked and comes before it, from where the points linked
+ * again since then are skipped by rank.
+ */
+static void relinkNode(const sweep_t * sw, dlnode_t * q){
+    
+    dlnode_t * list = sw->list;
+    dlnode_t * a, * b;
+    ghss_index_t i = q - list - 1;
+    int j;
+    
+    for(j = 0; j < 3; j++){
+        const ghss_index_t * rank = sw->rank[j];
+        
+        for(a = q->prev[j]; a != list && !isLinked(a); a = a->prev[j]);
+        while((b = a->next[j]) != list->prev[j] && rank[b - list - 1] < rank[i])
+            a = b;
+        q->prev[j] = a;
+        q->next[j] = b;
+        a->next[j] = q;
+        b->prev[j] = q;
+    }
+}
+
+// link all points of 'list' again, in the order given by 'rank' (scratch holds n pointers)
+static void relinkAll(dlnode_t * list, ghss_index_t n, const ghss_index_t * rank, dlnode_t ** scratch){
+    
+    ghss_index_t i;
+    int j;
+    
+    for(j = 0; j < 3; j++){
+        for(i = 0; i < n; i++)
+            scratch[rank[j * n + i]] = list + 1 + i;
+        linkAxis(list, scratch, n, j);
+    }
+}
+
+
+
+/*
+ * Copy the contributions changed in the last iteration to 'cv' and, as they may have to be
+ * updated in the next one, set the 'updated' flag of the corresponding points to false. The
+ * points that became dominated are unlinked.
+ */
+static void commitTouched(sweep_t * sw, double * cv){
+    
+    ghss_index_t i;
+    for(i = 0; i < sw->ntouched; i++){
+        dlnode_t * q = sw->touched[i];
+        cv[q - sw->list - 1] = q->contrib;
+        q->updated = 0;
+        if(q->dom && isLinked(q))
+            unlinkNode(q);
+    }
+    sw->ntouched = 0;
 }
 
 
@@ -370,31 +950,43 @@ static dlnode_t * maximumOutContributor(dlnode_t * list){
  * Note: The first and last elements of such list will be stored in p->cnext[0] (the rightmost
  * delimiter and below) and in p->cnext[1] (delimiter above and to the left)
  * 
+ * Only the points already selected are visited: they are found, in the order of the yi-list,
+ * from the set of their ranks along yi (sw->in), instead of walking the yi-list. This is O(m)
+ * for m points selected, not O(log m + delimiters): the selected points below p along yi are
+ * all visited to find xrightbelow, and those above p up to the last delimiter, since the set of
+ * ranks only gives their order along yi and not the ones below p along zi.
+ * 
  */
-static void createFloor(dlnode_t * list, dlnode_t * p, int xi, int yi, int zi, const double * ref){
+static void createFloor(sweep_t * sw, dlnode_t * p, int xi, int yi, int zi, const double * ref){
     
+    dlnode_t * list = sw->list;
     dlnode_t * q = list->prev[yi];
+    const posset_t * in = sw->in[yi];
+    const ghss_index_t * order = sw->order[yi];
+    ghss_index_t r;
     
     //set up sentinels
     list->x[xi] = ref[xi];
-    list->x[yi] = -DBL_MAX;
-    list->x[zi] = -DBL_MAX;
+    list->x[yi] = -COORD_MAX;
+    list->x[zi] = -COORD_MAX;
     
-    q->x[xi] = -DBL_MAX;
+    q->x[xi] = -COORD_MAX;
     q->x[yi] = ref[yi];
-    q->x[zi] = -DBL_MAX;
+    q->x[zi] = -COORD_MAX;
     
     
     dlnode_t * xrightbelow = list;
-    q = list->next[yi];
     
     
     //find the closest point to p according to the x-coordinate that has lower or equal yi- and zi- coordinates (xrightbelow)
-    while(q->x[yi] <= p->x[yi]){
-        if(q->in && q->x[zi] <= p->x[zi] && q->x[xi] <= xrightbelow->x[xi] && q->x[xi] > p->x[xi])
+    //(only the 'in' points are visited, in the order of the list, which is the order of their ranks)
+    for(r = possetNext(in, -1); r >= 0; r = possetNext(in, r)){
+        q = list + 1 + order[r];
+        if(q->x[yi] > p->x[yi])
+            break;
+        STATS_ADD(floor_nodes, 1);
+        if(q->x[zi] <= p->x[zi] && q->x[xi] <= xrightbelow->x[xi] && q->x[xi] > p->x[xi])
             xrightbelow = q;
-        
-        q = q->next[yi];
     }
     
     //the rightmost delimiter of p area to the right
@@ -402,12 +994,14 @@ static void createFloor(dlnode_t * list, dlnode_t * p, int xi, int yi, int zi, c
     
     dlnode_t * last = xrightbelow;
     
-    q = p->next[yi];
+    r = possetNext(in, sw->rank[yi][p - list - 1]);
+    q = (r >= 0) ? list + 1 + order[r] : list->prev[yi];
     
     //set up the list (using cnext)
-    while(!q->in || q->x[xi] > p->x[xi] || q->x[zi] > p->x[zi]){
+    while(q->x[xi] > p->x[xi] || q->x[zi] > p->x[zi]){
+        STATS_ADD(floor_nodes, 1);
         
-        if(q->in && q->x[zi] <= p->x[zi] && q->x[xi] < last->x[xi] && q->x[xi] > p->x[xi]){
+        if(q->x[zi] <= p->x[zi] && q->x[xi] < last->x[xi] && q->x[xi] > p->x[xi]){
             
             if(q->x[yi] == last->x[yi]){
                 last = last->cnext[0];
@@ -417,7 +1011,8 @@ static void createFloor(dlnode_t * list, dlnode_t * p, int xi, int yi, int zi, c
             last = q;
             
         }
-        q = q->next[yi];
+        r = possetNext(in, r);
+        q = (r >= 0) ? list + 1 + order[r] : list->prev[yi];
     }
     
     //the delimiter of p area above and to the left
@@ -443,6 +1038,7 @@ static double computeArea(dlnode_t * p, int xi, int yi){
     
     q = qnext;
     while(q != p->cnext[1]){
+        STATS_ADD(area_nodes, 1);
         qnext = q->cnext[1];
         area += (q->x[xi] - p->x[xi]) * (qnext->x[yi] - q->x[yi]);
         q = qnext;
@@ -465,8 +1061,9 @@ static double computeArea(dlnode_t * p, int xi, int yi){
  * Note: The first and last elements of the list of 'out' will be stored in p->cnextout[0] and in p->cnextout[1]
  * 
  */
-static void createAndInitializeBases(dlnode_t * list, dlnode_t * p, int xi, int yi, int zi){
+static void createAndInitializeBases(sweep_t * sw, dlnode_t * p, int xi, int yi, int zi){
     
+    dlnode_t * list = sw->list;
     dlnode_t * q;
     dlnode_t * stop = p->cnext[1];
     double parea = p->area;
@@ -493,14 +1090,17 @@ static void createAndInitializeBases(dlnode_t * list, dlnode_t * p, int xi, int
     //setup the list of 'out' points that have to be updated
     //and do the first part of the computation of their base area
     while(q != stop){
+        STATS_ADD(bases_nodes, 1);
+        ghss_prefetch(q->next[yi]);
         if(q != p){                                     // if p->prev[yi]->x[yi] == p->x[yi], then p will be visited in this while loop and has to be skipped
 
             if(q->dom){
+                STATS_ADD(dominated_skipped, 1);
                 q->updated = 1;
             
             }else if(q->in == 0){                       // q is out
 
-                if(q->updated == 0){                    // q has to be updated
+                if(q->updated == 0 && isOwned(sw, q, p)){   // q has to be updated
                     if(p->x[xi] <= q->x[xi] && p->x[yi] <= q->x[yi] && p->x[zi] <= q->x[zi]){
                         // q is dominated by p then, its contribution is reduced to 0
 
@@ -509,6 +1109,8 @@ static void createAndInitializeBases(dlnode_t * list, dlnode_t * p, int xi, int
                         q->oldcontrib = 0;
                         q->updated = 1;
                         q->dom = 1;
+                        sw->touched[sw->ntouched++] = q;
+                        STATS_ADD(reupdated, 1);
                             
                     }else if(p->x[xi] <= q->x[xi] && p->x[yi] <= q->x[yi] 
                         && (in->x[xi] > q->x[xi] || in->x[yi] > q->x[yi])
@@ -521,6 +1123,8 @@ static void createAndInitializeBases(dlnode_t * list, dlnode_t * p, int xi, int
                         out->cnextout[1] = q;
                         q->cprevout[1] = out;
                         out = q;
+                        sw->touched[sw->ntouched++] = q;
+                        STATS_ADD(reupdated, 1);
                     }
                 }
                 
@@ -558,10 +1162,13 @@ static void createAndInitializeBases(dlnode_t * list, dlnode_t * p, int xi, int
     
     //do the second part of the computation of the base area of the 'out' points to be updated
     while(q != stop){
+        STATS_ADD(bases_nodes, 1);
+        ghss_prefetch(q->next[xi]);
         if(q != p){
 
             if(q->dom){
 
+                STATS_ADD(dominated_skipped, 1);
                 q->updated = 1;
             
             }else if(q->in == 0){           //q is out
@@ -608,6 +1215,7 @@ static double cutOffPartial(dlnode_t * p, dlnode_t * cutter, int xi, int yi, int
     
     int yic = 1 - xic;
     
+    STATS_ADD(cutoff_calls, 1);
     dlnode_t * in = p->cnext[yic];
     dlnode_t * out = p->cnextout[yic];
     dlnode_t * stop;
@@ -628,6 +1236,7 @@ static double cutOffPartial(dlnode_t * p, dlnode_t * cutter, int xi, int yi, int
 
     
     while(in != stop){
+        STATS_ADD(cutoff_nodes, 1);
         
         if(in->cnext[yic]->x[xi] > out->x[xi] || out->x[xi] < p->x[xi]){
 
@@ -680,16 +1289,18 @@ static double cutOffPartial(dlnode_t * p, dlnode_t * cutter, int xi, int yi, int
  * avoid repeating some computations.
  * 
  */
-static void updateOut(dlnode_t * list, dlnode_t * p, int zi, const double * ref){
+static void updateOut(sweep_t * sw, dlnode_t * p, int zi, const double * ref){
 
+    dlnode_t * list = sw->list;
     int d = 3;
     int xi = (zi + 1) % d;  //first coordinate
     int yi = 3 - (zi + xi); //second coordinate
     dlnode_t * q = list;
     
-    createFloor(list, p, xi, yi, zi, ref);
+    STATS_ADD(updateout_passes, 1);
+    createFloor(sw, p, xi, yi, zi, ref);
     p->area = computeArea(p, xi, yi);
-    createAndInitializeBases(list, p, xi, yi, zi);
+    createAndInitializeBases(sw, p, xi, yi, zi);
     
     dlnode_t * stop = list->prev[zi];
     stop->x[zi] = ref[zi];
@@ -698,6 +1309,8 @@ static void updateOut(dlnode_t * list, dlnode_t * p, int zi, const double * ref)
     q = p->next[zi];
 
     while(q != stop){
+        STATS_ADD(sweep_nodes, 1);
+        ghss_prefetch(q->next[zi]);
 
         if(q->in){
             // update the area of p, update domr volume and area (Alg. 3) and do Algorithm 4 (lines 6 to 22) 
@@ -717,8 +1330,11 @@ static void updateOut(dlnode_t * list, dlnode_t * p, int zi, const double * ref)
             
             
         }else{                                                                       //q is an 'out' point
-            if(q->dom == 0 && q->updated == 0 && q->x[xi] <= p->x[xi] && q->x[yi] <= p->x[yi]){     //q* < p* (Alg. 3, lines 19 - 24)
+            if(q->dom == 0 && q->updated == 0 && q->x[xi] <= p->x[xi] && q->x[yi] <= p->x[yi]
+                && isOwned(sw, q, p)){                                                               //q* < p* (Alg. 3, lines 19 - 24)
                 
+                sw->touched[sw->ntouched++] = q;
+                STATS_ADD(reupdated, 1);
                 q->oldcontrib = q->contrib;
                 q->contrib = 0;
                 q->replaced = domr;
@@ -759,49 +1375,378 @@ static void updateOut(dlnode_t * list, dlnode_t * p, int zi, const double * ref)
 }
 
 
-static void gHSS3D(dlnode_t * list, const int k, int * selected, const double * ref){
+/* ---------------------------------- Concurrent sweeps -------------------------------------------*/
+
+
+static int nthreads = 1;
+
+void gHSS_set_threads(int n){
+    nthreads = (n < 1) ? 1 : n;
+}
+
+
+
+#if GHSS_THREADS
+
+// set in the threads that do several reference points at the same time (see greedyReferences)
+static __thread int serialSweeps = 0;
+
+// below this number of points the sweeps are too short to pay for the synchronization
+#ifndef CONCURRENT_MIN_N
+#define CONCURRENT_MIN_N 2048
+#endif
+
+
+typedef struct sweeppool sweeppool_t;
+
+typedef struct worker {
+    sweeppool_t * pool;
+    int tid;
+} worker_t;
+
+/*
+ * The three sweeps of an iteration (sweep[j] corresponds to updateOut(list, p, 2-j, ref)). Thread
+ * 'tid' does sweeps tid, tid + nthreads, ... and the main thread is thread 0.
+ */
+struct sweeppool {
+    sweep_t sweep[3];       // sweep[0] works on 'list', sweep[1] and sweep[2] on views
+    double ref[3][3];       // the reference point in the coordinates of each view
+    int nthreads;
+    worker_t worker[2];
+    pthread_t thread[2];
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    int generation;         // incremented each time there is a new point to add
+    int pending;            // number of workers that have not finished yet
+    int quit;
+    ghss_index_t pidx;      // index of the point being added (the same in 'list' and in views)
+};
+
+
+
+/*
+ * Create a copy of 'list' (of n points) in which coordinates xi, yi and zi become coordinates
+ * 0, 1 and 2, respectively, and so do the corresponding sorted lists. Sweeping the copy in order
+ * (x,y,z) is the same as sweeping 'list' in order (xi,yi,zi). Each view is a copy of all the
+ * nodes, so with three threads the nodes of the points take three times the memory.
+ */
+static dlnode_t * setupView(dlnode_t * list, ghss_index_t n, int zi){
     
-    int i;
-    dlnode_t * maxp = NULL;
+    int d = 3;
+    int xi = (zi + 1) % d;
+    int yi = 3 - (zi + xi);
+    int axis[3];
+    ghss_index_t i;
+    int j;
+    dlnode_t * view = ghssMalloc((n+2) * sizeof(dlnode_t));
+    
+    axis[0] = xi; axis[1] = yi; axis[2] = zi;
+    memcpy(view, list, (n+2) * sizeof(dlnode_t));
+    for(i = 0; i < n+2; i++){
+        for(j = 0; j < d; j++){
+            view[i].x[j] = list[i].x[axis[j]];
+            view[i].next[j] = view + (list[i].next[axis[j]] - list);
+            view[i].prev[j] = view + (list[i].prev[axis[j]] - list);
+        }
+    }
+    return view;
+}
+
+
+
+static void runSweeps(sweeppool_t * pool, int tid){
+    
+    int j;
+    for(j = tid; j < 3; j += pool->nthreads){
+        sweep_t * sw = &pool->sweep[j];
+        updateOut(sw, sw->list + pool->pidx, 2, pool->ref[j]);
+    }
+}
+
+
+
+static void * sweepWorker(void * arg){
+    
+    worker_t * w = (worker_t *) arg;
+    sweeppool_t * pool = w->pool;
+    int seen = 0;
+    int quit;
+    
+    for(;;){
+        pthread_mutex_lock(&pool->lock);
+        while(pool->generation == seen && !pool->quit)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        seen = pool->generation;
+        quit = pool->quit;
+        pthread_mutex_unlock(&pool->lock);
+        
+        if(quit) break;
+        runSweeps(pool, w->tid);
+        
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->pending == 0)
+            pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    
+#if GHSS_STATS
+    pthread_mutex_lock(&pool->lock);
+    statsMerge();
+    pthread_mutex_unlock(&pool->lock);
+#endif
+    return NULL;
+}
+
+
+
+static void freeSweepPool(sweeppool_t * pool){
+    
+    int j;
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    
+    for(j = 1; j < pool->nthreads; j++)
+        pthread_join(pool->thread[j-1], NULL);
+    
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    for(j = 1; j < 3; j++){
+        ghssFree(pool->sweep[j].list);
+        ghssFree(pool->sweep[j].touched);
+    }
+    ghssFree(pool);
+}
+
+
+
+/*
+ * Set up the views and the worker threads. sw is the sweep of 'list' (which becomes sweep[0]).
+ * Returns NULL if the threads could not be created.
+ */
+static sweeppool_t * setupSweepPool(sweep_t * sw, ghss_index_t n, const double * ref){
+    
+    int d = 3;
+    int i, j, l, zi, zj;
+    sweeppool_t * pool = ghssCalloc(1, sizeof(sweeppool_t));
+    
+    pool->nthreads = (nthreads < 3) ? nthreads : 3;
+    pool->sweep[0] = *sw;
+    
+    for(j = 0; j < 3; j++){
+        int axis[3], pos[3];
+        zi = 2 - j;
+        axis[0] = (zi + 1) % d;
+        axis[1] = 3 - (zi + axis[0]);
+        axis[2] = zi;
+        for(i = 0; i < d; i++){
+            pos[axis[i]] = i;
+            pool->ref[j][i] = ref[axis[i]];
+            pool->sweep[j].rank[i] = sw->rank[axis[i]];
+            pool->sweep[j].order[i] = sw->order[axis[i]];
+            pool->sweep[j].in[i] = sw->in[axis[i]];
+        }
+        
+        if(j > 0){
+            pool->sweep[j].list = setupView(sw->list, n, zi);
+            pool->sweep[j].touched = ghssMalloc(n * sizeof(dlnode_t *));
+            pool->sweep[j].ntouched = 0;
+        }
+        
+        // the sweeps that come before this one in the serial order (in the coordinates of view j)
+        pool->sweep[j].nprior = j;
+        for(l = 0; l < j; l++){
+            zj = 2 - l;
+            pool->sweep[j].prior[l][0] = pos[(zj + 1) % d];
+            pool->sweep[j].prior[l][1] = pos[3 - (zj + (zj + 1) % d)];
+            pool->sweep[j].prior[l][2] = pos[zj];
+        }
+    }
+    
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for(j = 1; j < pool->nthreads; j++){
+        pool->worker[j-1].pool = pool;
+        pool->worker[j-1].tid = j;
+        if(pthread_create(&pool->thread[j-1], NULL, sweepWorker, &pool->worker[j-1]) != 0){
+            pool->nthreads = j;
+            freeSweepPool(pool);
+            return NULL;
+        }
+    }
+    
+    return pool;
+}
+
+
+
+/*
+ * Do the three sweeps for the new point p concurrently and then merge their results, i.e., the
+ * new contribution of every point updated in a sweep is copied to 'list' and to the other views.
+ */
+static void updateOutConcurrent(sweeppool_t * pool, dlnode_t * p, double * cv){
+    
+    ghss_index_t i;
+    int j, l;
+    
+    pool->pidx = p - pool->sweep[0].list;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->pending = pool->nthreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    
+    runSweeps(pool, 0);
+    
+    pthread_mutex_lock(&pool->lock);
+    while(pool->pending > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    
+    for(j = 0; j < 3; j++){
+        sweep_t * sw = &pool->sweep[j];
+        for(i = 0; i < sw->ntouched; i++){
+            dlnode_t * q = sw->touched[i];
+            ghss_index_t idx = q - sw->list;
+            for(l = 0; l < 3; l++){
+                if(l != j){
+                    dlnode_t * r = pool->sweep[l].list + idx;
+                    r->contrib = q->contrib;
+                    r->dom = q->dom;
+                    if(r->dom && isLinked(r))
+                        unlinkNode(r);
+                }
+            }
+        }
+        commitTouched(sw, cv);
+    }
+}
+
+
+
+static void setInConcurrent(sweeppool_t * pool, dlnode_t * p){
+    
+    int j;
+    for(j = 1; j < 3; j++){
+        dlnode_t * r = pool->sweep[j].list + (p - pool->sweep[0].list);
+        if(!isLinked(r))
+            relinkNode(&pool->sweep[j], r);
+        r->in = 1;
+    }
+}
+
+#endif
+
+
+
+static void gHSS3D(dlnode_t * list, ghss_index_t n, const ghss_index_t k, ghss_index_t * selected, const double * ref,
+                   int updateLast){
+    
+    ghss_index_t i, last = (updateLast) ? k : k-1;      // selections followed by an update
+    dlnode_t * maxp = NULL;
     dlnode_t * p = list->next[0];
     dlnode_t *stop = list->prev[0];
+    sweep_t sw;
+    double * cv = ghssMalloc(n * sizeof(double));   // contributions of the points in the order of their nodes
+    ghss_index_t * key = nodeKeys(list, n);
+    ghss_index_t * rank = setupRanks(list, n);
+    posset_t in[3];     // ranks of the points selected along each axis
+    int j;
+    
     while(p != stop){
-        if(p->dom)
+        if(p->dom){
             p->contrib = 0; //if p does not strongly dominate the reference point
-        else
+            unlinkNode(p);  //p->next[0] is kept
+        }else
             p->contrib = (ref[0] - p->x[0]) * (ref[1] - p->x[1]) * (ref[2] - p->x[2]);
+        cv[p - list - 1] = p->contrib;
         p = p->next[0];
     }
     
+    sw.list = list;
+    sw.nprior = 0;
+    sw.touched = ghssMalloc(n * sizeof(dlnode_t *));
+    sw.ntouched = 0;
+    for(j = 0; j < 3; j++){
+        setupPosset(&in[j], n);
+        sw.rank[j] = rank + j * n;
+        sw.order[j] = rank + (3 + j) * n;
+        sw.in[j] = &in[j];
+    }
+    
+#if GHSS_THREADS
+    sweeppool_t * pool = NULL;
+    if(nthreads > 1 && !serialSweeps && n >= CONCURRENT_MIN_N && k > 1)
+        pool = setupSweepPool(&sw, n, ref);
+#endif
+    setupDone();
     
-    for(i = 0; i < k-1; i++){
+    for(i = 0; i < last; i++){
+        STATS_BEGIN_ITERATION();
         
-        maxp = maximumOutContributor(list);
+        maxp = maximumOutContributor(list, cv, key, n);
         if(maxp->dom == 0){
             //update contribution of the points not yet selected (out points)
-            updateOut(list, maxp, 2, ref); // order (x,y,z)
-            updateOut(list, maxp, 1, ref); // order (z,x,y)
-            updateOut(list, maxp, 0, ref); // order (y,z,x)
+#if GHSS_THREADS
+            if(pool){
+                updateOutConcurrent(pool, maxp, cv);
+            }else
+#endif
+            {
+                updateOut(&sw, maxp, 2, ref); // order (x,y,z)
+                updateOut(&sw, maxp, 1, ref); // order (z,x,y)
+                updateOut(&sw, maxp, 0, ref); // order (y,z,x)
+                commitTouched(&sw, cv);
+            }
+        }else if(!isLinked(maxp)){
+            relinkNode(&sw, maxp);
         }
         
         selected[i] = maxp->id;
         maxp->in = 1;   // point 'maxp' is now part of the set of selected points
-        
+        cv[maxp - list - 1] = ARGMAX_MASKED;
+        for(j = 0; j < 3; j++)
+            possetInsert(&in[j], sw.rank[j][maxp - list - 1]);
+#if GHSS_THREADS
+        if(pool) setInConcurrent(pool, maxp);
+#endif
+        STATS_END_ITERATION();
         
     }
     
-    maxp = maximumOutContributor(list);
-    selected[i] = maxp->id;
-    maxp->in = 1;
+    if(i < k){
+        maxp = maximumOutContributor(list, cv, key, n);
+        selected[i] = maxp->id;
+        maxp->in = 1;
+    }
     
+#if GHSS_THREADS
+    if(pool) freeSweepPool(pool);
+#endif
+    // the lists are left as they were set up (see greedyList and resetList)
+    relinkAll(list, n, rank, sw.touched);
+    for(j = 2; j >= 0; j--)
+        freePosset(&in[j]);
+    ghssFree(sw.touched);
+    ghssFree(rank);
+    ghssFree(key);
+    ghssFree(cv);
 }
 
 
 
 
-static void gHSS2D(dlnode_t * list, const int k, int * selected, const double * ref){
+static void gHSS2D(dlnode_t * list, ghss_index_t n, const ghss_index_t k, ghss_index_t * selected, const double * ref,
+                   int updateLast){
     
-    int i;
+    ghss_index_t i, last = (updateLast) ? k : k-1;      // selections followed by an update
+    double * cv = ghssMalloc(n * sizeof(double));   // contributions of the points in the order of their nodes
+    ghss_index_t * key = nodeKeys(list, n);
     dlnode_t * maxp = NULL;
     dlnode_t * p = list->next[0];
     dlnode_t * q = list;
@@ -809,11 +1754,11 @@ static void gHSS2D(dlnode_t * list, const int k, int * selected, const double *
     dlnode_t * rightin, * upin;
     
     // set sentinels
-    list->x[0] = -DBL_MAX;
+    list->x[0] = -COORD_MAX;
     list->x[1] = ref[1];
     
     stop->x[0] = ref[0];
-    stop->x[1] = -DBL_MAX;
+    stop->x[1] = -COORD_MAX;
     
     // setup list with cnext, excluding dominated points
     while(p != stop){
@@ -840,9 +1785,14 @@ static void gHSS2D(dlnode_t * list, const int k, int * selected, const double *
     q->cnext[0] = stop;
     stop->cnext[1] = q;
     
+    for(i = 0; i < n; i++)
+        cv[i] = list[i+1].contrib;
+    setupDone();
+    
     // greedy subset selection in 2D
-    for(i = 0; i < k-1; i++){
-        maxp = maximumOutContributor(list); //find the point that contributes the most to the already selected points
+    for(i = 0; i < last; i++){
+        STATS_BEGIN_ITERATION();
+        maxp = maximumOutContributor(list, cv, key, n); //find the point that contributes the most to the already selected points
         if(maxp->dom == 0){
             upin = maxp->cnext[1];
 
@@ -854,12 +1804,16 @@ static void gHSS2D(dlnode_t * list, const int k, int * selected, const double *
             p = maxp->cnext[0];
             while(p != rightin){
                 p->contrib -= (rightin->x[0]-p->x[0]) * (upin->x[1]-maxp->x[1]);
+                cv[p - list - 1] = p->contrib;
+                STATS_ADD(reupdated, 1);
                 p = p->cnext[0];
             }
             
             p = maxp->cnext[1];
             while(p != upin){
                 p->contrib -= (rightin->x[0]-maxp->x[0]) * (upin->x[1]-p->x[1]);
+                cv[p - list - 1] = p->contrib;
+                STATS_ADD(reupdated, 1);
                 p = p->cnext[1];
             }
             
@@ -869,124 +1823,1417 @@ static void gHSS2D(dlnode_t * list, const int k, int * selected, const double *
         
         selected[i] = maxp->id;
         maxp->in = 1;           // point 'maxp' is in now part of the set of selected points
+        cv[maxp - list - 1] = ARGMAX_MASKED;
+        STATS_END_ITERATION();
     }
     
-    // no need to update the data structure after selecting the k-th point
-    maxp = maximumOutContributor(list);
-    selected[i] = maxp->id;
-    maxp->in = 1;
+    // no need to update the data structure after selecting the k-th point, unless asked to
+    if(i < k){
+        maxp = maximumOutContributor(list, cv, key, n);
+        selected[i] = maxp->id;
+        maxp->in = 1;
+    }
     
+    ghssFree(key);
+    ghssFree(cv);
+}
+
+
+/* --------------------------------------- 2D (arrays) -------------------------------------------*/
+
+
+static int engine = GHSS_ENGINE_AUTO;
+
+void gHSS_set_engine(int e){
+    engine = e;
 }
 
 
+
+typedef struct point2d {
+    coord_t x[2];
+    ghss_index_t id;
+} point2d_t;
+
+
 /*
- * mark and initialize the points that do not strongly dominate the reference point and return
- * how many of such points exist  
+ * The nondominated points sorted by x (and so by decreasing y) and the remaining ones, i.e. the
+ * points that are dominated or do not dominate the reference point, which contribute 0.
  */
-int markInvalidPoints(dlnode_t * list, int d, const double * ref){
-    
-    int di;
-    dlnode_t * p;
-    dlnode_t * stop;
-    
-    int nmarked = 0;
-    
-    for(di = 0; di < d; di++){
-        
-        p = list->prev[di]->prev[di];
-        stop = list;
-        while(p != stop && p->x[di] >= ref[di]){
-            if(p->dom == 0){
-                p->dom = 1;
-                p->contrib = 0;
-                p->oldcontrib = 0;
-                p->area = 0;
-                nmarked++;
-            }
-            p = p->prev[di];
+typedef struct chain2d {
+    ghss_index_t m;     // number of nondominated points
+    coord_t * x;        // their coordinates
+    coord_t * y;
+    ghss_index_t * id;
+    ghss_index_t nzero; // number of the remaining points
+    ghss_index_t * zero;// their ids, in increasing order
+} chain2d_t;
+
+
+/*
+ * Sort by x, then by y and then by id, i.e., the order of list->next[0] in gHSS2D (the lists
+ * are sorted with a stable qsort, first by y and then by x).
+ */
+static int compare_point2d(const void *p1, const void* p2)
+{
+    const point2d_t * a = (const point2d_t *) p1;
+    const point2d_t * b = (const point2d_t *) p2;
+
+    if(a->x[0] != b->x[0]) return (a->x[0] < b->x[0]) ? -1 : 1;
+    if(a->x[1] != b->x[1]) return (a->x[1] < b->x[1]) ? -1 : 1;
+    return (a->id < b->id) ? -1 : (a->id > b->id);
+}
+
+
+
+/*
+ * The points in 'data', sorted as in compare_point2d. The order does not depend on the reference
+ * point, so it can be shared by several calls to setupChain2d. If 'perm' is not NULL, the points
+ * are taken in the order perm[0], ..., perm[n-1] of greedyhss_sort instead, which only differs
+ * from compare_point2d if qsort is not stable, and then only among points with equal x, so the
+ * insertion sort that follows is linear.
+ */
+static point2d_t * sortPoints2d(const points_t * data, ghss_index_t n, const ghss_index_t * perm){
+
+    ghss_index_t i, j;
+    point2d_t * pts = ghssMalloc(n * sizeof(point2d_t));
+
+    for(i = 0; i < n; i++){
+        j = (perm) ? perm[i] : i;
+        pts[i].x[0] = coord(data, j, 0);
+        pts[i].x[1] = coord(data, j, 1);
+        pts[i].id = j;
+    }
+    if(!perm){
+        qsort(pts, n, sizeof(point2d_t), compare_point2d);
+        return pts;
+    }
+    for(i = 1; i < n; i++){
+        point2d_t p = pts[i];
+        for(j = i; j > 0 && compare_point2d(&pts[j-1], &p) > 0; j--)
+            pts[j] = pts[j-1];
+        pts[j] = p;
+    }
+    return pts;
+}
+
+
+
+/*
+ * Setup 'ch' with the points 'pts' given by sortPoints2d. Points with equal coordinates are
+ * handled as in gHSS2D.
+ */
+static void setupChain2d(chain2d_t * ch, const point2d_t * pts, ghss_index_t n, const double * ref){
+
+    ghss_index_t i, m = 0;
+    char * inchain = ghssCalloc(n, sizeof(char));
+
+    ch->x = ghssMalloc(n * sizeof(coord_t));
+    ch->y = ghssMalloc(n * sizeof(coord_t));
+    ch->id = ghssMalloc(n * sizeof(ghss_index_t));
+
+    // keep the nondominated points (same filter as gHSS2D)
+    for(i = 0; i < n; i++){
+        const point2d_t * p = pts + i;
+        if(p->x[0] >= ref[0] || p->x[1] >= ref[1]){
+            continue;
+        }else if(m > 0 && p->x[0] == ch->x[m-1] && ch->y[m-1] >= p->x[1]){
+            m--;
+        }else if(p->x[1] >= ((m > 0) ? ch->y[m-1] : ref[1])){
+            continue;
         }
+        ch->x[m] = p->x[0];
+        ch->y[m] = p->x[1];
+        ch->id[m] = p->id;
+        m++;
     }
-    
-    return nmarked;
-    
+    ch->m = m;
+    for(i = 0; i < m; i++)
+        inchain[ch->id[i]] = 1;
+
+    ch->nzero = 0;
+    ch->zero = ghssMalloc((n - m) * sizeof(ghss_index_t));
+    for(i = 0; i < n; i++)
+        if(!inchain[i]) ch->zero[ch->nzero++] = i;
+    ghssFree(inchain);
 }
 
 
-/* Input:
- * data - array containing all 3D points
- * n - number of points
- * k - subset size (select the k most promising points, one at a time)
- * ref - reference point
- * 
- * Output:
- * the total volume of the subset selected is returned
- * 'contribs' - the contribution of the selected points at the time their
- *              were selected (ex.: contribs[i] holds the contribution of
- *              the i-th selected point)
- * 'selected' - the index of the selected points regarding their order
- *              in 'data' (ex.: selected[i] holds the index of the i-th
- *              selected point. selected[i] holds a value in the range [0,...,n-1]) 
+
+static void freeChain2d(chain2d_t * ch){
+    ghssFree(ch->x);
+    ghssFree(ch->y);
+    ghssFree(ch->id);
+    ghssFree(ch->zero);
+}
+
+
+
+/*
+ * Decide between the point of the chain with the largest contribution (cmax, and position s, is
+ * ARGMAX_MASKED if there is none) and the first point left in 'zero', breaking ties by id.
  */
-double greedyhss(double *data, int d, int n, const int k, const double *ref, double * contribs, int * selected)
-{
-    
-    
-    infoFile = stdout;
-    double totalhv = 0;
+static inline int pickZero(const chain2d_t * ch, ghss_index_t izero, double cmax, ghss_index_t s){
 
-    dlnode_t *list;
+    if(cmax == ARGMAX_MASKED) return 1;
+    if(izero == ch->nzero) return 0;
+    return cmax < 0 || (cmax == 0 && ch->zero[izero] < ch->id[s]);
+}
 
-    list = setup_cdllist(data, d, n);
-    
-    int nmarked = markInvalidPoints(list, d, ref);
-    if(nmarked == n){
-        int i;
-        for(i = 0; i < n; i++){
-            selected[i] = i;
+
+
+/*
+ * Same as gHSS2D, but without the doubly linked lists. The nondominated points are kept sorted
+ * by x in contiguous arrays (x, y, contribution, in) and the sentinels are implicit: the one to
+ * the left of position 0 is (-COORD_MAX, ref[1]) and the one to the right of position m-1 is
+ * (ref[0], -COORD_MAX). The contributions changed after a selection are a range of positions on
+ * each side of the selected point, which is updated by a plain loop that the compiler vectorises.
+ * Ties are broken by id, so the same points as in gHSS2D are selected.
+ * Returns the sum of the contributions of the selected points.
+ */
+static double greedyhss2d(const point2d_t * pts, ghss_index_t n, const ghss_index_t k, const double * ref, double * contribs,
+                          ghss_index_t * selected){
+
+    ghss_index_t i, j, s, l, r, m, izero = 0;
+    double xr, yl, dx, dy, cmax, totalhv = 0;
+    chain2d_t ch;
+
+    setupChain2d(&ch, pts, n, ref);
+    m = ch.m;
+
+    const coord_t * restrict x = ch.x;
+    const coord_t * restrict y = ch.y;
+    double * restrict c = ghssMalloc(m * sizeof(double));
+    char * in = ghssCalloc(m, sizeof(char));
+    for(j = 0; j < m; j++)
+        c[j] = (ref[0] - x[j]) * (ref[1] - y[j]);
+    setupDone();
+
+    for(i = 0; i < k; i++){
+        STATS_BEGIN_ITERATION();
+        STATS_ADD(argmax_calls, 1);
+        STATS_ADD(argmax_entries, m);
+        s = (m > 0) ? argmax_key(c, ch.id, m) : 0;
+        cmax = (m > 0) ? c[s] : ARGMAX_MASKED;
+
+        if(pickZero(&ch, izero, cmax, s)){
+            selected[i] = ch.zero[izero++];
             contribs[i] = 0;
+            STATS_END_ITERATION();
+            continue;
         }
-        free(list);
-        return 0;
+
+        selected[i] = ch.id[s];
+        contribs[i] = c[s];
+        totalhv += c[s];
+
+        // no need to update the contributions after selecting the k-th point
+        if(i < k-1){
+            for(l = s - 1; l >= 0 && !in[l]; l--);
+            for(r = s + 1; r < m && !in[r]; r++);
+            yl = (l >= 0) ? y[l] : ref[1];
+            xr = (r < m) ? x[r] : ref[0];
+
+            dy = yl - y[s];
+            for(j = s + 1; j < r; j++)
+                c[j] -= (xr - x[j]) * dy;
+
+            dx = xr - x[s];
+            for(j = l + 1; j < s; j++)
+                c[j] -= dx * (yl - y[j]);
+            STATS_ADD(reupdated, r - l - 2);
+        }
+
+        in[s] = 1;
+        c[s] = ARGMAX_MASKED;
+        STATS_END_ITERATION();
     }
-    
-    
-    if (d == 2){
-        gHSS2D(list, k, selected, ref);
-    }else if(d == 3){
-        gHSS3D(list, k, selected, ref);
+
+    ghssFree(c);
+    ghssFree(in);
+    freeChain2d(&ch);
+
+    return totalhv;
+}
+
+
+
+/* ------------------------------------ 2D (segment tree) ----------------------------------------*/
+
+/*
+ * After selecting the point at position s of the chain, whose nearest selected points are at
+ * positions l < s < r, the contribution of the points at positions s+1 to r-1 is lowered by
+ * (x[r] - x[j]) * (y[l] - y[s]) and that of the points at positions l+1 to s-1 by
+ * (x[r] - x[s]) * (y[l] - y[j]). That is, a*x[j] + b*y[j] + c is added to the contributions of a
+ * range of positions, with a >= 0 and b = 0 on the right side and a = 0 and b >= 0 on the left.
+ *
+ * These updates are lazy in a kinetic segment tree over the positions. Each internal node keeps
+ * the position of the largest contribution in its subtree (ties broken by id) and how much 'a'
+ * (tx) and 'b' (ty) can be added to it before the result of one of the comparisons in the subtree
+ * may change. Since x increases and y decreases with the position, adding 'a' only favours the
+ * right child and adding 'b' only favours the left one, so each comparison bounds one of them.
+ * When an update exceeds tx or ty, it is pushed to the children and the node is recomputed.
+ *
+ * The contributions are updated in a different order (and rounded differently) than in
+ * greedyhss2d, so contributions that differ only by rounding errors may be ordered differently.
+ */
+
+typedef struct segtree {
+    ghss_index_t size;  // number of leaves, a power of 2 (leaf i + size is position i)
+    const coord_t * x;
+    const coord_t * y;
+    const ghss_index_t * id;
+    double * v;         // contribution of each position (ARGMAX_MASKED if selected or unused)
+    ghss_index_t * best;        // internal node -> position of the largest contribution (-1 if none)
+    double * val;       //                  ... and its value
+    double * ta;        //                  a, b and c not yet added to the children
+    double * tb;
+    double * tc;
+    double * tx;        //                  a and b that can be added before 'best' may change
+    double * ty;
+} segtree_t;
+
+
+
+static void nodeState(const segtree_t * t, ghss_index_t i, ghss_index_t * best, double * val, double * tx, double * ty){
+
+    if(i >= t->size){
+        *best = (t->v[i - t->size] != ARGMAX_MASKED) ? i - t->size : -1;
+        *val = t->v[i - t->size];
+        *tx = *ty = DBL_MAX;
     }else{
-        free(list);
-        return -1;
+        *best = t->best[i];
+        *val = t->val[i];
+        *tx = t->tx[i];
+        *ty = t->ty[i];
     }
-    int * sel2idx = (int *) malloc(n * sizeof(int));
-    dlnode_t * p = list->next[0];
-    dlnode_t * stop = list->prev[0];
-    int i = 0;
-    
-    for(i = 0; i < n; i++){
-        sel2idx[i] = n;
+}
+
+
+
+static void segtreePull(segtree_t * t, ghss_index_t i){
+
+    ghss_index_t bl, br;
+    double vl, vr, txl, tyl, txr, tyr;
+
+    nodeState(t, 2*i, &bl, &vl, &txl, &tyl);
+    nodeState(t, 2*i+1, &br, &vr, &txr, &tyr);
+    t->tx[i] = min(txl, txr);
+    t->ty[i] = min(tyl, tyr);
+
+    if(bl < 0 || br < 0){
+        t->best[i] = (bl < 0) ? br : bl;
+        t->val[i] = (bl < 0) ? vr : vl;
+    }else if(vl > vr || (vl == vr && t->id[bl] < t->id[br])){
+        t->best[i] = bl;
+        t->val[i] = vl;
+        t->tx[i] = min(t->tx[i], (vl - vr) / (t->x[br] - t->x[bl]));
+    }else{
+        t->best[i] = br;
+        t->val[i] = vr;
+        t->ty[i] = min(t->ty[i], (vr - vl) / (t->y[bl] - t->y[br]));
     }
-    for(i = 0; i < k; i++){
-        sel2idx[selected[i]] = i;
+}
+
+
+
+static void segtreePush(segtree_t * t, ghss_index_t i);
+
+/* add a*x + b*y + c to the contributions of the positions in the subtree of node i */
+static void segtreeApply(segtree_t * t, ghss_index_t i, double a, double b, double c){
+
+    if(i >= t->size){
+        ghss_index_t j = i - t->size;
+        if(t->v[j] != ARGMAX_MASKED)
+            t->v[j] += a * t->x[j] + b * t->y[j] + c;
+        return;
     }
-    
-    
-    while(p != stop){
-        if(sel2idx[p->id] < k){
-            contribs[sel2idx[p->id]] = p->contrib;
-            totalhv += p->contrib;
-        }
-        p = p->next[0];
-        i++;
+    if(t->best[i] < 0)
+        return;
+
+    t->val[i] += a * t->x[t->best[i]] + b * t->y[t->best[i]] + c;
+    t->ta[i] += a;
+    t->tb[i] += b;
+    t->tc[i] += c;
+
+    if((a > 0 && a >= t->tx[i]) || (b > 0 && b >= t->ty[i])){
+        segtreePush(t, i);
+        segtreePull(t, i);
+    }else{
+        t->tx[i] -= a;
+        t->ty[i] -= b;
     }
-    
+}
 
-    free(sel2idx);
-    free(list);
-    
-    return totalhv;
+
+
+static void segtreePush(segtree_t * t, ghss_index_t i){
+
+    if(t->ta[i] != 0 || t->tb[i] != 0 || t->tc[i] != 0){
+        segtreeApply(t, 2*i, t->ta[i], t->tb[i], t->tc[i]);
+        segtreeApply(t, 2*i+1, t->ta[i], t->tb[i], t->tc[i]);
+        t->ta[i] = t->tb[i] = t->tc[i] = 0;
+    }
+}
+
+
+
+/* add a*x + b*y + c to the contributions of positions 'from' to 'to'-1 */
+static void segtreeUpdate(segtree_t * t, ghss_index_t i, ghss_index_t lo, ghss_index_t hi, ghss_index_t from, ghss_index_t to,
+                          double a, double b, double c){
+
+    if(to <= lo || hi <= from)
+        return;
+    if(from <= lo && hi <= to){
+        segtreeApply(t, i, a, b, c);
+        return;
+    }
+    segtreePush(t, i);
+    segtreeUpdate(t, 2*i, lo, (lo + hi) / 2, from, to, a, b, c);
+    segtreeUpdate(t, 2*i+1, (lo + hi) / 2, hi, from, to, a, b, c);
+    segtreePull(t, i);
 }
 
 
 
+/* the point at position j was selected */
+static void segtreeRemove(segtree_t * t, ghss_index_t i, ghss_index_t lo, ghss_index_t hi, ghss_index_t j){
+
+    if(i >= t->size){
+        t->v[j] = ARGMAX_MASKED;
+        return;
+    }
+    segtreePush(t, i);
+    if(j < (lo + hi) / 2)
+        segtreeRemove(t, 2*i, lo, (lo + hi) / 2, j);
+    else
+        segtreeRemove(t, 2*i+1, (lo + hi) / 2, hi, j);
+    segtreePull(t, i);
+}
+
 
+
+static void setupSegtree(segtree_t * t, const chain2d_t * ch, const double * ref){
+
+    ghss_index_t i;
+
+    for(t->size = 2; t->size < ch->m; t->size *= 2);
+    t->x = ch->x;
+    t->y = ch->y;
+    t->id = ch->id;
+    t->v = ghssMalloc(t->size * sizeof(double));
+    t->best = ghssMalloc(t->size * sizeof(ghss_index_t));
+    t->val = ghssMalloc(t->size * sizeof(double));
+    t->ta = ghssCalloc(t->size, sizeof(double));
+    t->tb = ghssCalloc(t->size, sizeof(double));
+    t->tc = ghssCalloc(t->size, sizeof(double));
+    t->tx = ghssMalloc(t->size * sizeof(double));
+    t->ty = ghssMalloc(t->size * sizeof(double));
+
+    for(i = 0; i < t->size; i++)
+        t->v[i] = (i < ch->m) ? (ref[0] - ch->x[i]) * (ref[1] - ch->y[i]) : ARGMAX_MASKED;
+    for(i = t->size - 1; i >= 1; i--)
+        segtreePull(t, i);
+}
+
+
+
+static void freeSegtree(segtree_t * t){
+    ghssFree(t->v); ghssFree(t->best); ghssFree(t->val);
+    ghssFree(t->ta); ghssFree(t->tb); ghssFree(t->tc);
+    ghssFree(t->tx); ghssFree(t->ty);
+}
+
+
+
+/*
+ * Same as greedyhss2d but each selection takes O(log n) amortised time instead of O(n). The
+ * contribution of each selected point is computed from its nearest selected points.
+ */
+static double greedyhss2dtree(const point2d_t * pts, ghss_index_t n, const ghss_index_t k, const double * ref, double * contribs,
+                              ghss_index_t * selected){
+
+    ghss_index_t i, s, l, r, m, izero = 0;
+    double xr, yl, dx, dy, cmax, totalhv = 0;
+    chain2d_t ch;
+    segtree_t t;
+    posset_t in;
+
+    setupChain2d(&ch, pts, n, ref);
+    m = ch.m;
+    setupSegtree(&t, &ch, ref);
+    setupPosset(&in, m);
+    setupDone();
+
+    for(i = 0; i < k; i++){
+        STATS_BEGIN_ITERATION();
+        s = t.best[1];
+        cmax = (s >= 0) ? t.val[1] : ARGMAX_MASKED;
+
+        if(pickZero(&ch, izero, cmax, s)){
+            selected[i] = ch.zero[izero++];
+            contribs[i] = 0;
+            STATS_END_ITERATION();
+            continue;
+        }
+
+        l = possetPrev(&in, s);
+        r = possetNext(&in, s);
+        yl = (l >= 0) ? ch.y[l] : ref[1];
+        xr = (r >= 0) ? ch.x[r] : ref[0];
+        if(r < 0) r = m;
+
+        selected[i] = ch.id[s];
+        contribs[i] = (xr - ch.x[s]) * (yl - ch.y[s]);
+        totalhv += contribs[i];
+
+        // no need to update the contributions after selecting the k-th point
+        if(i < k-1){
+            dy = yl - ch.y[s];
+            if(s + 1 < r)
+                segtreeUpdate(&t, 1, 0, t.size, s + 1, r, dy, 0, -xr * dy);
+            dx = xr - ch.x[s];
+            if(l + 1 < s)
+                segtreeUpdate(&t, 1, 0, t.size, l + 1, s, 0, dx, -dx * yl);
+            STATS_ADD(reupdated, r - l - 2);
+        }
+
+        segtreeRemove(&t, 1, 0, t.size, s);
+        possetInsert(&in, s);
+        STATS_END_ITERATION();
+    }
+
+    freePosset(&in);
+    freeSegtree(&t);
+    freeChain2d(&ch);
+
+    return totalhv;
+}
+
+
+
+/* --------------------------------------- 3D (lazy) ---------------------------------------------*/
+
+/*
+ * For k much smaller than n. The contribution of a point can only decrease as points are
+ * selected, so the last value computed for it is an upper bound of its current contribution.
+ * The points are kept in a max-heap of these bounds (ties broken by id), starting from the
+ * volume of the box between each point and the reference point, which is exact while nothing is
+ * selected. The contribution of the point at the top is only computed, against the points
+ * selected so far, when its bound is stale. The point is then moved down the heap and, if it
+ * stays at the top, its bound is exact and no larger than any other, so it is selected.
+ *
+ * Each contribution takes O(m^2) time at most for the m points selected, and no time is spent
+ * on the points whose bound never reaches the top. The contributions are computed in a different
+ * way (and rounded differently) than in gHSS3D, so contributions that differ only by rounding
+ * errors may be ordered differently.
+ */
+
+// the lazy engine is chosen by GHSS_ENGINE_AUTO for k up to LAZY_MAX_K and n at least LAZY_MIN_RATIO * k
+#ifndef LAZY_MAX_K
+#define LAZY_MAX_K 1000
+#endif
+#ifndef LAZY_MIN_RATIO
+#define LAZY_MIN_RATIO 100
+#endif
+
+typedef struct bound {
+    double v;           // upper bound of the contribution
+    ghss_index_t id;
+    ghss_index_t m;     // number of points selected when v was computed
+} bound_t;
+
+
+static inline int boundAbove(const bound_t * a, const bound_t * b){
+    return a->v > b->v || (a->v == b->v && a->id < b->id);
+}
+
+
+static void boundSiftDown(bound_t * heap, ghss_index_t size, ghss_index_t i){
+
+    bound_t b = heap[i];
+    ghss_index_t c;
+
+    while((c = 2 * i + 1) < size){
+        if(c + 1 < size && boundAbove(&heap[c+1], &heap[c]))
+            c++;
+        if(!boundAbove(&heap[c], &b))
+            break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    heap[i] = b;
+}
+
+
+
+/*
+ * Add (x, y) to the staircase st[0..*ns-1] (sorted by ascending x and descending y) of the points
+ * that delimit the area dominated in the (x, y) plane, bounded by ref, and return how much that
+ * area grew.
+ */
+static double stairInsert(double (*st)[2], ghss_index_t * ns, double x, double y, const double * ref){
+
+    ghss_index_t lo = 0, hi = *ns, mid, i, j;
+    double xa, ya, added = 0;
+
+    while(lo < hi){
+        mid = lo + (hi - lo) / 2;
+        if(st[mid][0] <= x) lo = mid + 1;
+        else hi = mid;
+    }
+    if(lo > 0 && st[lo-1][1] <= y)
+        return 0;
+
+    // sum the strips of [x, ref[0]] x [y, ya] not yet dominated, up to the first point below y
+    xa = x;
+    ya = (lo > 0) ? st[lo-1][1] : ref[1];
+    for(j = lo; j < *ns && st[j][1] >= y; j++){
+        added += (st[j][0] - xa) * (ya - y);
+        xa = st[j][0];
+        ya = st[j][1];
+    }
+    added += (((j < *ns) ? st[j][0] : ref[0]) - xa) * (ya - y);
+
+    // (x, y) replaces the points it dominates
+    i = (lo > 0 && st[lo-1][0] == x) ? lo - 1 : lo;
+    memmove(st + i + 1, st + j, (*ns - j) * sizeof(*st));
+    st[i][0] = x;
+    st[i][1] = y;
+    *ns += i + 1 - j;
+    return added;
+}
+
+
+
+/*
+ * Contribution of p to the m points in 'sel' (sorted by ascending z, each strongly dominating
+ * ref): the box between p and ref is swept along z, and the area of its slice not dominated by
+ * the points swept so far, projected onto it, shrinks at the z of each of them. 'st' holds up to
+ * m points.
+ */
+static double lazyContribution(const double * p, const double (*sel)[3], ghss_index_t m, const double * ref,
+                               double (*st)[2]){
+
+    ghss_index_t i, ns = 0;
+    double area = (ref[0] - p[0]) * (ref[1] - p[1]);
+    double z = p[2], vol = 0;
+    double x, y, sz;
+
+    for(i = 0; i < m; i++){
+        sz = (sel[i][2] > p[2]) ? sel[i][2] : p[2];
+        vol += area * (sz - z);
+        z = sz;
+        x = (sel[i][0] > p[0]) ? sel[i][0] : p[0];
+        y = (sel[i][1] > p[1]) ? sel[i][1] : p[1];
+        if(x == p[0] && y == p[1])
+            return vol;         // the rest of the box is dominated
+        area -= stairInsert(st, &ns, x, y, ref);
+    }
+    return vol + area * (ref[2] - z);
+}
+
+
+
+/*
+ * Coordinates of point i, rounded as in the lists. Returns 0 if it does not strongly dominate
+ * the reference point.
+ */
+static int lazyPoint(const points_t * data, ghss_index_t i, const double * ref, double * p){
+
+    int j, valid = 1;
+
+    for(j = 0; j < 3; j++){
+        p[j] = (coord_t) coord(data, i, j);
+        if(p[j] >= ref[j])
+            valid = 0;
+    }
+    return valid;
+}
+
+
+
+/*
+ * Same as greedyList in 3D, but the points are neither sorted nor linked.
+ */
+static double greedyhss3dlazy(const points_t * data, ghss_index_t n, const ghss_index_t k, const double * ref,
+                              double * contribs, ghss_index_t * selected){
+
+    ghss_index_t i, j, size = n, m = 0;
+    double p[3], totalhv = 0;
+    bound_t * heap = ghssMalloc(n * sizeof(bound_t));
+    double (*sel)[3] = ghssMalloc(k * sizeof(*sel));    // the valid points selected, by ascending z
+    double (*st)[2] = ghssMalloc(k * sizeof(*st));
+
+    for(i = 0; i < n; i++){
+        heap[i].id = i;
+        if(lazyPoint(data, i, ref, p)){
+            heap[i].v = (ref[0] - p[0]) * (ref[1] - p[1]) * (ref[2] - p[2]);
+            heap[i].m = 0;
+        }else{
+            heap[i].v = 0;
+            heap[i].m = k;      // never stale
+        }
+    }
+    for(i = n / 2; i-- > 0; )
+        boundSiftDown(heap, n, i);
+    setupDone();
+
+    for(i = 0; i < k; i++){
+        STATS_BEGIN_ITERATION();
+
+        while(heap[0].m < i){
+            lazyPoint(data, heap[0].id, ref, p);
+            heap[0].v = lazyContribution(p, (const double (*)[3]) sel, m, ref, st);
+            heap[0].m = i;
+            boundSiftDown(heap, size, 0);
+            STATS_ADD(reupdated, 1);
+        }
+
+        selected[i] = heap[0].id;
+        contribs[i] = heap[0].v;
+        totalhv += heap[0].v;
+
+        if(lazyPoint(data, heap[0].id, ref, p)){
+            for(j = m; j > 0 && sel[j-1][2] > p[2]; j--)
+                memcpy(sel[j], sel[j-1], sizeof(*sel));
+            memcpy(sel[j], p, sizeof(*sel));
+            m++;
+        }
+        heap[0] = heap[--size];
+        boundSiftDown(heap, size, 0);
+        STATS_END_ITERATION();
+    }
+
+    ghssFree(st);
+    ghssFree(sel);
+    ghssFree(heap);
+
+    return totalhv;
+}
+
+
+
+/*
+ * mark and initialize the points that do not strongly dominate the reference point and return
+ * how many of such points exist  
+ */
+ghss_index_t markInvalidPoints(dlnode_t * list, int d, const double * ref){
+    
+    int di;
+    dlnode_t * p;
+    dlnode_t * stop;
+    
+    ghss_index_t nmarked = 0;
+    
+    for(di = 0; di < d; di++){
+        
+        p = list->prev[di]->prev[di];
+        stop = list;
+        while(p != stop && p->x[di] >= ref[di]){
+            if(p->dom == 0){
+                p->dom = 1;
+                p->contrib = 0;
+                p->oldcontrib = 0;
+                p->area = 0;
+                nmarked++;
+            }
+            p = p->prev[di];
+        }
+    }
+    
+    return nmarked;
+    
+}
+
+
+/*
+ * Clear the fields of the nodes of 'list' (n points and the two sentinels) that depend on the
+ * reference point, so that the sorted lists can be used again for another one.
+ */
+static void resetList(dlnode_t * list, int d, ghss_index_t n){
+
+    ghss_index_t i;
+    int j;
+    dlnode_t * p;
+
+    for(i = 0; i < n+2; i++){
+        p = list + i;
+        p->in = (i == 0 || i == n+1);
+        p->updated = 0;
+        p->dom = 0;
+        p->area = 0; p->contrib = 0; p->oldcontrib = 0; p->lastSlicez = 0;
+        p->cnext[0] = p->cnext[1] = NULL;
+        p->cnextout[0] = p->cnextout[1] = NULL;
+        p->cprevout[0] = p->cprevout[1] = NULL;
+        p->replaced = NULL;
+    }
+    for(j = 0; j < d; j++){
+        list[0].x[j] = -1;
+        list[n+1].x[j] = -1;
+    }
+}
+
+
+
+/*
+ * Contribution of each point not selected to the points selected, in 'remaining' by index (0 for
+ * the points selected), after gHSS2D or gHSS3D were asked to update them after the last
+ * selection. gHSS2D keeps only the contributions of the points not dominated by others, so those
+ * of the dominated ones are computed from the staircase of the points selected along cnext.
+ */
+static void remainingContribs(dlnode_t * list, int d, ghss_index_t n, const ghss_index_t k, const double * ref,
+                              double * remaining){
+
+    dlnode_t * p, * stop = list + n + 1;
+    double * sx = NULL, * sy = NULL;
+    double x, y, area;
+    ghss_index_t m = 0, lo, hi, mid;
+
+    if(d == 2){
+        sx = ghssMalloc(k * sizeof(double));
+        sy = ghssMalloc(k * sizeof(double));
+        for(p = list->cnext[0]; p != stop; p = p->cnext[0]){
+            if(p->in){
+                sx[m] = p->x[0];
+                sy[m] = p->x[1];
+                m++;
+            }
+        }
+    }
+
+    for(p = list->next[0]; p != stop; p = p->next[0]){
+        if(p->in || d != 2 || !p->dom || p->x[0] >= ref[0] || p->x[1] >= ref[1]){
+            remaining[p->id] = (p->in) ? 0 : p->contrib;
+            continue;
+        }
+        // the strips of the box of p above the staircase, up to the first point below p
+        lo = 0; hi = m;
+        while(lo < hi){
+            mid = lo + (hi - lo) / 2;
+            if(sx[mid] <= p->x[0]) lo = mid + 1;
+            else hi = mid;
+        }
+        x = p->x[0];
+        y = (lo > 0) ? sy[lo-1] : ref[1];
+        area = 0;
+        while(y > p->x[1]){
+            area += (((lo < m) ? sx[lo] : ref[0]) - x) * (y - p->x[1]);
+            if(lo == m)
+                break;
+            x = sx[lo];
+            y = sy[lo];
+            lo++;
+        }
+        remaining[p->id] = area;
+    }
+
+    ghssFree(sy);
+    ghssFree(sx);
+}
+
+
+
+/*
+ * Greedy selection on the sorted lists 'list' (set up by setup_cdllist, or reset by resetList).
+ * If 'remaining' is not NULL, it receives the contribution of every point to the k points
+ * selected (see remainingContribs).
+ */
+static double greedyList(dlnode_t * list, int d, ghss_index_t n, const ghss_index_t k, const double *ref, double * contribs,
+                         ghss_index_t * selected, double * remaining)
+{
+    double totalhv = 0;
+    
+    ghss_index_t nmarked = markInvalidPoints(list, d, ref);
+    if(nmarked == n){
+        ghss_index_t i;
+        for(i = 0; i < k; i++){
+            selected[i] = i;
+            contribs[i] = 0;
+        }
+        for(i = 0; remaining && i < n; i++)
+            remaining[i] = 0;
+        return 0;
+    }
+    
+    
+    if (d == 2){
+        gHSS2D(list, n, k, selected, ref, remaining != NULL);
+    }else{
+        gHSS3D(list, n, k, selected, ref, remaining != NULL);
+    }
+    if(remaining)
+        remainingContribs(list, d, n, k, ref, remaining);
+    ghss_index_t * sel2idx = (ghss_index_t *) ghssMalloc(n * sizeof(ghss_index_t));
+    dlnode_t * p = list->next[0];
+    dlnode_t * stop = list->prev[0];
+    ghss_index_t i = 0;
+    
+    for(i = 0; i < n; i++){
+        sel2idx[i] = n;
+    }
+    for(i = 0; i < k; i++){
+        sel2idx[selected[i]] = i;
+    }
+    
+    
+    while(p != stop){
+        if(sel2idx[p->id] < k){
+            contribs[sel2idx[p->id]] = p->contrib;
+            totalhv += p->contrib;
+        }
+        p = p->next[0];
+        i++;
+    }
+    
+
+    ghssFree(sel2idx);
+    
+    return totalhv;
+}
+
+
+
+/*
+ * Whether the lazy engine is used for n points in d dimensions. The list engine sorts the points
+ * and sweeps parts of the lists after each selection, which the lazy engine does not, but the
+ * cost of each of its contributions grows with k.
+ */
+static int useLazy(int d, ghss_index_t n, ghss_index_t k){
+    if(d != 3)
+        return 0;
+    if(engine == GHSS_ENGINE_LAZY)
+        return 1;
+    return engine == GHSS_ENGINE_AUTO && k <= LAZY_MAX_K && n >= LAZY_MIN_RATIO * k;
+}
+
+
+
+/* -------------------------------------- Degenerate inputs --------------------------------------*/
+
+/*
+ * The columns (bit j for column j) in which all the points have the same coordinate, value[j],
+ * once rounded as the lists round them, below the reference point. The volume dominated by any
+ * subset is then the one in the other columns times the product of ref[j] - value[j], so that the
+ * greedy selection is the same in the other columns. Stops at the first points that differ in
+ * every column, which is at the second point for most inputs.
+ */
+static int constantColumns(const points_t * data, int d, ghss_index_t n, const double * ref, double * value){
+
+    int j, mask = (1 << d) - 1;
+    ghss_index_t i;
+
+    if(n < 1)
+        return 0;
+    for(j = 0; j < d; j++)
+        value[j] = (coord_t) coord(data, 0, j);
+    for(i = 1; i < n && mask != 0; i++)
+        for(j = 0; j < d; j++)
+            if((mask & (1 << j)) && (coord_t) coord(data, i, j) != value[j])
+                mask &= ~(1 << j);
+    for(j = 0; j < d; j++)
+        if(value[j] >= ref[j])
+            mask &= ~(1 << j);
+    return mask;
+}
+
+
+
+/*
+ * Greedy selection in 1D, with the coordinates in column j and the volumes multiplied by scale:
+ * the valid point with the smallest coordinate (the first one, if several) and then, with no
+ * contribution, the other points by index, as gHSS3D selects them.
+ */
+static double greedyhss1d(const points_t * data, int j, ghss_index_t n, const ghss_index_t k, const double * ref,
+                          double scale, double * contribs, ghss_index_t * selected){
+
+    ghss_index_t i, m = 0, best = -1;
+    double x, min = 0;
+
+    for(i = 0; i < n; i++){
+        x = (coord_t) coord(data, i, j);
+        if(x < ref[j] && (best < 0 || x < min)){
+            best = i;
+            min = x;
+        }
+    }
+    setupDone();
+
+    if(best >= 0 && k > 0){
+        selected[m] = best;
+        contribs[m++] = (ref[j] - min) * scale;
+    }
+    for(i = 0; m < k; i++){
+        if(i == best)
+            continue;
+        selected[m] = i;
+        contribs[m++] = 0;
+    }
+    return (best >= 0 && k > 0) ? contribs[0] : 0;
+}
+
+
+
+static double greedySubset(const points_t *data, int d, ghss_index_t n, const ghss_index_t k, const double *ref,
+                           const ghss_index_t * perm, double * contribs, ghss_index_t * selected);
+
+/*
+ * Greedy selection in 3D of points that have the same coordinate in the columns in mask (see
+ * constantColumns), in the other columns.
+ */
+static double greedyReduced(const points_t * data, ghss_index_t n, const ghss_index_t k, const double * ref,
+                            const ghss_index_t * perm, int mask, const double * value,
+                            double * contribs, ghss_index_t * selected){
+
+    points_t sub = *data;
+    ghss_index_t i, * subperm = NULL;
+    double subref[2], scale = 1, totalhv = 0;
+    int j, m = 0, axis[3];
+
+    if(mask == 7)       // the points are all the same: the first one is selected
+        mask = 6;
+    for(j = 0; j < 3; j++){
+        if(mask & (1 << j))
+            scale *= ref[j] - value[j];
+        else
+            axis[m++] = j;
+    }
+
+    if(m == 1)
+        return greedyhss1d(data, axis[0], n, k, ref, scale, contribs, selected);
+
+    sub.base += axis[0] * data->colstride;
+    sub.colstride = (axis[1] - axis[0]) * data->colstride;
+    subref[0] = ref[axis[0]];
+    subref[1] = ref[axis[1]];
+    if(perm && axis[1] != axis[0] + 1){
+        subperm = ghssMalloc(2 * n * sizeof(ghss_index_t));
+        memcpy(subperm, perm + axis[0] * n, n * sizeof(ghss_index_t));
+        memcpy(subperm + n, perm + axis[1] * n, n * sizeof(ghss_index_t));
+    }
+
+    greedySubset(&sub, 2, n, k, subref, (subperm) ? subperm : (perm) ? perm + axis[0] * n : NULL,
+                 contribs, selected);
+    ghssFree(subperm);
+    for(i = 0; i < k; i++){
+        contribs[i] *= scale;
+        totalhv += contribs[i];
+    }
+    return totalhv;
+}
+
+
+
+static double greedySubset(const points_t *data, int d, ghss_index_t n, const ghss_index_t k, const double *ref,
+                           const ghss_index_t * perm, double * contribs, ghss_index_t * selected)
+{
+    
+    
+    infoFile = stdout;
+    double totalhv = 0;
+
+    dlnode_t *list;
+
+    if(d != 2 && d != 3)
+        return -1;
+
+    if(d == 3 && engine == GHSS_ENGINE_AUTO){
+        double value[3];
+        int mask = constantColumns(data, d, n, ref, value);
+        if(mask)
+            return greedyReduced(data, n, k, ref, perm, mask, value, contribs, selected);
+    }
+
+    if(useLazy(d, n, k))
+        return greedyhss3dlazy(data, n, k, ref, contribs, selected);
+
+    if(d == 2 && engine != GHSS_ENGINE_LIST && engine != GHSS_ENGINE_LAZY){
+        point2d_t * pts = sortPoints2d(data, n, perm);
+        if(engine == GHSS_ENGINE_TREE)
+            totalhv = greedyhss2dtree(pts, n, k, ref, contribs, selected);
+        else
+            totalhv = greedyhss2d(pts, n, k, ref, contribs, selected);
+        ghssFree(pts);
+        return totalhv;
+    }
+
+    list = setup_cdllist(data, d, n, perm);
+    totalhv = greedyList(list, d, n, k, ref, contribs, selected, NULL);
+    ghssFree(list);
+    
+    return totalhv;
+}
+
+
+
+// the sentinels take coordinates of the reference point, so it is rounded as the points are
+static void roundReference(double * cref, const double * ref, int d){
+    int i;
+    for(i = 0; i < d && i < 3; i++)
+        cref[i] = (coord_t) ref[i];
+}
+
+
+
+/* -------------------------------- Many reference points ----------------------------------------*/
+
+/*
+ * The order of the points does not depend on the reference point, so the sorted lists (or, in 2D,
+ * the sorted array of the array engines) are set up once and each reference point is done on
+ * them after resetList. With more than one thread, each thread takes the next reference point
+ * that was not done yet and works on its own copy of the lists, in its own arena. The sweeps of a
+ * run are then not split among threads (see serialSweeps). The lazy engine sorts nothing and
+ * reads the points as given for each reference point.
+ */
+typedef struct multiref {
+    int d;
+    ghss_index_t n, k;
+    const double * refs;
+    int nref;
+    double * contribs;
+    ghss_index_t * selected;
+    double * hv;
+    const point2d_t * pts;      // sorted points (2D array engines), or NULL
+    const points_t * data;      // the points as given (3D lazy engine), or NULL
+    int next;                   // next reference point to do
+#if GHSS_THREADS
+    pthread_mutex_t lock;
+#endif
+} multiref_t;
+
+typedef struct refworker {
+    multiref_t * mr;
+    dlnode_t * list;            // copy of the sorted lists, NULL for the other engines
+} refworker_t;
+
+
+
+// do the reference points left in 'mr' on 'list'
+static void runReferences(multiref_t * mr, dlnode_t * list){
+
+    int r;
+    double cref[3];
+
+    while((r = __atomic_fetch_add(&mr->next, 1, __ATOMIC_RELAXED)) < mr->nref){
+        double * contribs = mr->contribs + (size_t) r * mr->k;
+        ghss_index_t * selected = mr->selected + (size_t) r * mr->k;
+        arena_mark_t mark = arena_mark(callArena);
+
+        roundReference(cref, mr->refs + (size_t) r * mr->d, mr->d);
+        if(mr->data){
+            mr->hv[r] = greedyhss3dlazy(mr->data, mr->n, mr->k, cref, contribs, selected);
+        }else if(list){
+            resetList(list, mr->d, mr->n);
+            mr->hv[r] = greedyList(list, mr->d, mr->n, mr->k, cref, contribs, selected, NULL);
+        }else if(engine == GHSS_ENGINE_TREE){
+            mr->hv[r] = greedyhss2dtree(mr->pts, mr->n, mr->k, cref, contribs, selected);
+        }else{
+            mr->hv[r] = greedyhss2d(mr->pts, mr->n, mr->k, cref, contribs, selected);
+        }
+        arena_rewind(callArena, mark);
+    }
+}
+
+
+
+#if GHSS_THREADS
+
+// copy of 'list' whose links point into the copy
+static dlnode_t * copyList(const dlnode_t * list, int d, ghss_index_t n){
+
+    ghss_index_t i;
+    int j;
+    dlnode_t * copy = ghssMalloc((n+2) * sizeof(dlnode_t));
+
+    memcpy(copy, list, (n+2) * sizeof(dlnode_t));
+    for(i = 0; i < n+2; i++){
+        for(j = 0; j < d; j++){
+            copy[i].next[j] = copy + (list[i].next[j] - list);
+            copy[i].prev[j] = copy + (list[i].prev[j] - list);
+        }
+    }
+    return copy;
+}
+
+
+
+static void * referenceWorker(void * arg){
+
+    refworker_t * w = (refworker_t *) arg;
+    multiref_t * mr = w->mr;
+
+    callArena = arena_new((size_t) mr->n * (sizeof(double) + 2 * sizeof(dlnode_t *)),
+                          (arenaFlags & GHSS_ARENA_PREFAULT) ? ARENA_PREFAULT : 0);
+    serialSweeps = 1;
+    runReferences(mr, w->list);
+    arena_delete(callArena);
+    callArena = NULL;
+
+#if GHSS_STATS
+    pthread_mutex_lock(&mr->lock);
+    statsMerge();
+    pthread_mutex_unlock(&mr->lock);
+#endif
+    return NULL;
+}
+
+#endif
+
+
+
+static void greedyReferences(const points_t *data, int d, ghss_index_t n, const ghss_index_t k, const double *refs,
+                             int nref, const ghss_index_t * perm, double * contribs, ghss_index_t * selected,
+                             double * hv){
+
+    multiref_t mr;
+    dlnode_t * list = NULL;
+    point2d_t * pts = NULL;
+
+    if(nref < 1)
+        return;
+    memset(&mr, 0, sizeof(mr));
+    mr.d = d; mr.n = n; mr.k = k;
+    mr.refs = refs; mr.nref = nref;
+    mr.contribs = contribs; mr.selected = selected; mr.hv = hv;
+
+    infoFile = stdout;
+    if(useLazy(d, n, k))
+        mr.data = data;
+    else if(d == 2 && engine != GHSS_ENGINE_LIST && engine != GHSS_ENGINE_LAZY)
+        mr.pts = pts = sortPoints2d(data, n, perm);
+    else
+        list = setup_cdllist(data, d, n, perm);
+    setupDone();
+
+#if GHSS_THREADS
+    int t, nworkers = ((nthreads < nref) ? nthreads : nref) - 1;
+    refworker_t worker[(nworkers > 0) ? nworkers : 1];
+    pthread_t thread[(nworkers > 0) ? nworkers : 1];
+
+    if(nworkers > 0){
+        pthread_mutex_init(&mr.lock, NULL);
+        serialSweeps = 1;
+        // the copies are made before the lists are modified by the first run
+        for(t = 0; t < nworkers; t++){
+            worker[t].mr = &mr;
+            worker[t].list = (list) ? copyList(list, d, n) : NULL;
+        }
+        for(t = 0; t < nworkers; t++)
+            if(pthread_create(&thread[t], NULL, referenceWorker, &worker[t]) != 0)
+                break;
+        nworkers = t;
+    }
+#endif
+
+    runReferences(&mr, list);
+
+#if GHSS_THREADS
+    for(t = 0; t < nworkers; t++)
+        pthread_join(thread[t], NULL);
+    if(serialSweeps){
+        serialSweeps = 0;
+        pthread_mutex_destroy(&mr.lock);
+    }
+#endif
+
+    ghssFree(list);
+    ghssFree(pts);
+}
+
+
+
+/*
+ * Start and end of a call: reset the counters, take the time and set up the arena for n points
+ */
+static struct timespec callStart[2];
+
+static void beginCall(ghss_index_t n){
+#if GHSS_STATS
+    memset(&stats, 0, sizeof(stats));
+    memset(&tstats, 0, sizeof(tstats));
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &callStart[0]);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &callStart[1]);
+    setupMarked = 0;
+
+    beginArena((size_t) (n + 2) * (sizeof(dlnode_t) + 2 * sizeof(double) + sizeof(dlnode_t *)));
+}
+
+static void endCall(void){
+    struct timespec end[2];
+
+    endArena();
+
+    clock_gettime(CLOCK_MONOTONIC, &end[0]);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end[1]);
+    if(!setupMarked){
+        setupMark[0] = end[0];
+        setupMark[1] = end[1];
+    }
+    timings.setup_wall = elapsed(&callStart[0], &setupMark[0]);
+    timings.setup_cpu = elapsed(&callStart[1], &setupMark[1]);
+    timings.selection_wall = elapsed(&setupMark[0], &end[0]);
+    timings.selection_cpu = elapsed(&setupMark[1], &end[1]);
+
+#if GHSS_STATS
+    statsMerge();
+#endif
+}
+
+
+
+/* Input:
+ * data - array containing all 3D points
+ * n - number of points
+ * k - subset size (select the k most promising points, one at a time)
+ * ref - reference point
+ * 
+ * Output:
+ * the total volume of the subset selected is returned
+ * 'contribs' - the contribution of the selected points at the time their
+ *              were selected (ex.: contribs[i] holds the contribution of
+ *              the i-th selected point)
+ * 'selected' - the index of the selected points regarding their order
+ *              in 'data' (ex.: selected[i] holds the index of the i-th
+ *              selected point. selected[i] holds a value in the range [0,...,n-1]) 
+ */
+double greedyhss(double *data, int d, ghss_index_t n, const ghss_index_t k, const double *ref, double * contribs,
+                 ghss_index_t * selected)
+{
+    return greedyhss_strided(data, d * sizeof(double), sizeof(double), d, n, k, ref, contribs, selected);
+}
+
+
+
+/*
+ * Same as greedyhss, but coordinate j of point i is the double at address
+ * (const char *) base + i * rowstride + j * colstride, e.g., rowstride = sizeof(double) and
+ * colstride = n * sizeof(double) for an n-by-d array in column-major order.
+ */
+double greedyhss_strided(const double *base, ptrdiff_t rowstride, ptrdiff_t colstride, int d,
+                         ghss_index_t n, const ghss_index_t k, const double *ref, double * contribs,
+                         ghss_index_t * selected)
+{
+    double totalhv;
+    points_t data = {(const char *) base, rowstride, colstride};
+    double cref[3];
+
+    roundReference(cref, ref, d);
+
+    beginCall(n);
+    totalhv = greedySubset(&data, d, n, k, cref, NULL, contribs, selected);
+    endCall();
+
+    return totalhv;
+}
+
+
+
+/*
+ * Same as greedyhss_strided, and remaining[i] is set to the contribution of the i-th point to the
+ * k points selected (0 if it was selected). The list engine is used whatever the engine set,
+ * since it is the one that keeps the contributions of all points up to date, and the
+ * contributions are updated once more after the k-th selection.
+ */
+double greedyhss_remaining(const double *base, ptrdiff_t rowstride, ptrdiff_t colstride, int d,
+                           ghss_index_t n, const ghss_index_t k, const double *ref, double * contribs,
+                           ghss_index_t * selected, double * remaining)
+{
+    double totalhv;
+    points_t pts = {(const char *) base, rowstride, colstride};
+    dlnode_t * list;
+    double cref[3];
+
+    if(d != 2 && d != 3)
+        return -1;
+
+    roundReference(cref, ref, d);
+
+    beginCall(n);
+    infoFile = stdout;
+    list = setup_cdllist(&pts, d, n, NULL);
+    totalhv = greedyList(list, d, n, k, cref, contribs, selected, remaining);
+    ghssFree(list);
+    endCall();
+
+    return totalhv;
+}
+
+
+
+/*
+ * Same as greedyhss for each of the nref reference points in 'refs' (nref * d doubles, one point
+ * after the other), but the points are sorted only once. The results for the r-th reference point
+ * are in contribs[r*k], ..., contribs[r*k + k-1], selected[r*k], ..., selected[r*k + k-1] and
+ * hv[r]. Up to the number of threads set by gHSS_set_threads reference points are done at the
+ * same time. Returns 0, or -1 if d is not 2 or 3.
+ */
+int greedyhss_multiref(const double *data, int d, ghss_index_t n, const ghss_index_t k, const double *refs,
+                       int nref, double * contribs, ghss_index_t * selected, double * hv)
+{
+    points_t pts = {(const char *) data, d * sizeof(double), sizeof(double)};
+
+    if(d != 2 && d != 3)
+        return -1;
+
+    beginCall(n);
+    greedyReferences(&pts, d, n, k, refs, nref, NULL, contribs, selected, hv);
+    endCall();
+
+    return 0;
+}
+
+
+
+/*
+ * Order of the points along each dimension, as sorted by greedyhss: perm[j*n + i] is the index
+ * of the i-th point along dimension j. Returns 0, or -1 if d is not 2 or 3.
+ */
+int greedyhss_sort(const double *data, int d, ghss_index_t n, ghss_index_t *perm)
+{
+    points_t pts = {(const char *) data, d * sizeof(double), sizeof(double)};
+    dlnode_t * list, * p;
+    ghss_index_t i;
+    int j;
+
+    if(d != 2 && d != 3)
+        return -1;
+
+    beginCall(n);
+    list = setup_cdllist(&pts, d, n, NULL);
+    for(j = 0; j < d; j++)
+        for(i = 0, p = list->next[j]; i < n; i++, p = p->next[j])
+            perm[j*n + i] = p->id;
+    ghssFree(list);
+    endCall();
+
+    return 0;
+}
+
+
+
+/*
+ * Same as greedyhss_multiref, with the order of the points given by greedyhss_sort for the same
+ * points (e.g., saved from an earlier run), so that they are not sorted again.
+ */
+int greedyhss_presorted(const double *data, const ghss_index_t *perm, int d, ghss_index_t n,
+                        const ghss_index_t k, const double *refs, int nref, double * contribs,
+                        ghss_index_t * selected, double * hv)
+{
+    points_t pts = {(const char *) data, d * sizeof(double), sizeof(double)};
+    double cref[3];
+
+    if(d != 2 && d != 3)
+        return -1;
+
+    beginCall(n);
+    if(nref == 1){
+        roundReference(cref, refs, d);
+        hv[0] = greedySubset(&pts, d, n, k, cref, perm, contribs, selected);
+    }else{
+        greedyReferences(&pts, d, n, k, refs, nref, perm, contribs, selected, hv);
+    }
+    endCall();
+
+    return 0;
+}
@@ -31,11 +31,148 @@
 #ifndef GHSS_H_
 #define GHSS_H_
 
+#include <stddef.h>
+#if GHSS_LARGE
+# include <inttypes.h>
+#else
+# include <limits.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-double greedyhss(double *data, int d, int n, const int k, const double *ref, double * volumes, int * selected);
+/* Version of the interface of libghss (the soname is libghss.so.GHSS_API_VERSION) */
+#define GHSS_API_VERSION 1
+
+/* Type of the number of points, of k and of the indices of the points. It is int, unless gHSS
+   is built for large inputs (make LARGE=1, which defines GHSS_LARGE), in which case it is
+   int64_t and there may be more than 2^31 - 1 points. Programs that use such a build must be
+   compiled with GHSS_LARGE defined too. GHSS_INDEX_MAX is its largest value and GHSS_PRIindex its printf conversion ("%" GHSS_PRIindex). */
+#if GHSS_LARGE
+typedef int64_t ghss_index_t;
+# define GHSS_INDEX_MAX INT64_MAX
+# define GHSS_PRIindex PRId64
+#else
+typedef int ghss_index_t;
+# define GHSS_INDEX_MAX INT_MAX
+# define GHSS_PRIindex "d"
+#endif
+
+/* Algorithms that greedyhss may use (see gHSS_set_engine) */
+#define GHSS_ENGINE_AUTO  0    /* the fastest one for the dimension of the data (default) */
+#define GHSS_ENGINE_LIST  1    /* gHSS2D and gHSS3D, on doubly linked lists */
+#define GHSS_ENGINE_ARRAY 2    /* 2D only: the nondominated points are kept in contiguous arrays */
+#define GHSS_ENGINE_TREE  3    /* 2D only: O((n + k) log n) with a segment tree */
+#define GHSS_ENGINE_LAZY  4    /* 3D only: for small k, the contributions are computed when they may be the largest */
+
+/* Order of the nodes of the lists of points in memory (see gHSS_set_layout) */
+#define GHSS_LAYOUT_INPUT  0   /* the order of the input (default) */
+#define GHSS_LAYOUT_AXIS   1   /* ascending order of the last coordinate */
+#define GHSS_LAYOUT_ZORDER 2   /* Z-order (Morton order) of the ranks of the points along each axis */
+
+/* Flags of gHSS_set_arena */
+#define GHSS_ARENA_REUSE    1  /* keep the memory of a call for the next call of the same thread */
+#define GHSS_ARENA_PREFAULT 2  /* fault in the memory of a call as soon as it is mapped */
+
+/* Counters of a call to greedyhss (see gHSS_get_stats) */
+#define GHSS_STATS_BUCKETS 40
+
+typedef struct ghss_stats {
+    unsigned long long iterations;          /* selections timed in 'latency' */
+    unsigned long long argmax_calls;        /* searches for the maximum contributor */
+    unsigned long long argmax_entries;      /* contributions compared in those searches */
+    unsigned long long updateout_passes;    /* calls to updateOut (three per selection in 3D) */
+    unsigned long long sweep_nodes;         /* points visited by the sweeps of updateOut */
+    unsigned long long floor_nodes;         /* points visited by createFloor */
+    unsigned long long area_nodes;          /* delimiters visited by computeArea */
+    unsigned long long bases_nodes;         /* points visited by createAndInitializeBases */
+    unsigned long long cutoff_calls;        /* calls to cutOffPartial */
+    unsigned long long cutoff_nodes;        /* delimiters visited by cutOffPartial */
+    unsigned long long reupdated;           /* contributions of 'out' points that were updated */
+    unsigned long long dominated_skipped;   /* dominated points skipped by createAndInitializeBases */
+    unsigned long long unlinked;            /* dominated points unlinked from the sorted lists */
+    unsigned long long latency[GHSS_STATS_BUCKETS]; /* selections that took [2^i, 2^(i+1)) ns */
+} ghss_stats_t;
+
+/* Wall-clock and CPU time (in seconds) of a call to greedyhss (see gHSS_get_timings) */
+typedef struct ghss_timings {
+    double setup_wall;          /* sorting the points and computing their initial contributions */
+    double setup_cpu;
+    double selection_wall;      /* the greedy selection */
+    double selection_cpu;
+} ghss_timings_t;
+
+double greedyhss(double *data, int d, ghss_index_t n, const ghss_index_t k, const double *ref, double * volumes,
+                 ghss_index_t * selected);
+
+/* Same as greedyhss, but the points are read in place: coordinate j of point i is the double at
+   (const char *) base + i * rowstride + j * colstride. The strides are in bytes, so that the
+   coordinates may be, e.g., in column-major order or fields of an array of structs. */
+double greedyhss_strided(const double *base, ptrdiff_t rowstride, ptrdiff_t colstride, int d,
+                         ghss_index_t n, const ghss_index_t k, const double *ref, double * volumes,
+                         ghss_index_t * selected);
+
+/* Same as greedyhss_strided, and remaining[i] (remaining holds n doubles) is set to the
+   contribution of the i-th point to the k points selected, or to 0 if it was selected, e.g., for
+   a selection based on the contributions of the points left out. It always uses the list engine
+   (GHSS_ENGINE_LIST), which keeps these contributions up to date. Returns -1 if d is not 2 or 3. */
+double greedyhss_remaining(const double *base, ptrdiff_t rowstride, ptrdiff_t colstride, int d,
+                           ghss_index_t n, const ghss_index_t k, const double *ref, double * volumes,
+                           ghss_index_t * selected, double * remaining);
+
+/* Same as greedyhss for each of the nref reference points in 'refs' (one after the other), but
+   the points are sorted only once. The k results for reference point r start at volumes + r*k
+   and selected + r*k, and its hypervolume is hv[r]. Returns 0, or -1 if d is not 2 or 3. */
+int greedyhss_multiref(const double *data, int d, ghss_index_t n, const ghss_index_t k, const double *refs,
+                       int nref, double * volumes, ghss_index_t * selected, double * hv);
+
+/* Order of the points along each dimension, as greedyhss sorts them: perm[j*n + i] is the index
+   of the i-th point along dimension j (perm holds d*n indices). Returns 0, or -1 if d is not 2 or 3. */
+int greedyhss_sort(const double *data, int d, ghss_index_t n, ghss_index_t *perm);
+
+/* Same as greedyhss_multiref, with the order of the points given by greedyhss_sort for the same
+   points and the same build of gHSS (e.g., saved by an earlier run), so that they are linked in
+   linear time instead of being sorted. */
+int greedyhss_presorted(const double *data, const ghss_index_t *perm, int d, ghss_index_t n,
+                        const ghss_index_t k, const double *refs, int nref, double * volumes,
+                        ghss_index_t * selected, double * hv);
+
+/* Number of threads used for the three sweeps done by gHSS3D after each selection (at most 3
+   are used), or by greedyhss_multiref to do several reference points at the same time. Each
+   thread other than the first works on its own copy of the nodes of the points, so the memory
+   they take grows with the number of threads used (up to three times in gHSS3D). It has no
+   effect unless gHSS was built with GHSS_THREADS. */
+void gHSS_set_threads(int nthreads);
+
+/* Algorithm used by greedyhss (one of GHSS_ENGINE_*). An algorithm that does not apply to the
+   dimension of the data is replaced by GHSS_ENGINE_LIST. GHSS_ENGINE_ARRAY gives the same
+   output as GHSS_ENGINE_LIST. GHSS_ENGINE_TREE and GHSS_ENGINE_LAZY add up the contributions in
+   another order, so these may differ in the last digits, and points whose contributions differ
+   only by rounding errors may be selected in a different order, or other points selected after
+   them. GHSS_ENGINE_AUTO uses GHSS_ENGINE_LAZY in 3D for k up to 1000 and n at least 100 k,
+   and, in 3D, selects points that all have the same coordinate in one or two dimensions in the other
+   ones (where the volumes are those in 3D divided by the same factor), which may break ties
+   between points with the same coordinates in another way. */
+void gHSS_set_engine(int engine);
+
+/* Order in which the list engine (GHSS_ENGINE_LIST, and gHSS3D) stores the points in memory, one
+   of GHSS_LAYOUT_*. The sweeps follow the lists sorted along each axis, which jump around memory
+   when the points are in the order of the input; the other layouts place points that are close
+   along the lists close in memory. The points selected are the same in every layout. */
+void gHSS_set_layout(int layout);
+
+/* How greedyhss manages its memory (a combination of GHSS_ARENA_*, 0 by default). The memory of
+   a call is taken from 2 MB aligned chunks that may be backed by transparent huge pages. With
+   GHSS_ARENA_REUSE it is kept between calls, and gHSS_set_arena(0) releases it. */
+void gHSS_set_arena(int flags);
+
+/* Copy the counters of the last call to greedyhss to 'stats'. Returns 0 (and sets them to 0) if
+   gHSS was built without GHSS_STATS (make STATS=1), since nothing is counted in that case. */
+int gHSS_get_stats(ghss_stats_t * stats);
+
+/* Copy the time taken by the phases of the last call to greedyhss to 'timings' */
+void gHSS_get_timings(ghss_timings_t * timings);
 
 #ifdef __cplusplus
 }
@@ -35,17 +35,738 @@
 #include "string.h" /* strerror */
 #include "errno.h" /* errno */
 
+#if GHSS_THREADS
+#include <pthread.h>
+#endif
+#if GHSS_ZLIB
+#include <zlib.h>
+#endif
+#if GHSS_ZSTD
+#include <zstd.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define READ_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #define PAGE_SIZE 4096          /* allocate one page at a time      */
 #define DATA_INC (PAGE_SIZE/sizeof(double))
 
+/* Compressed input.
+
+   A file (or standard input) that starts with the magic bytes of gzip
+   or zstd is decompressed while it is read: read_data parses a stream
+   made with fopencookie, which hands out blocks of decompressed text.
+   With threads, the blocks are decompressed ahead by a thread of their
+   own (at most DECODE_NBLOCKS of them), so that decompression overlaps
+   with parsing.  A stream that cannot be rewound after its first bytes
+   were read to check them (a pipe) goes through the same path without
+   being decompressed.  */
+
+#define CODEC_NONE 0
+#define CODEC_GZIP 1
+#define CODEC_ZSTD 2
+
+#define DECODE_INPUT   (256 * 1024)    /* compressed bytes read at a time */
+#define DECODE_BLOCK   (1024 * 1024)   /* decompressed bytes handed at a time */
+#define DECODE_NBLOCKS 4
+
+static const char *const codec_name[] = { "plain", "gzip", "zstd" };
+
+typedef struct decoder {
+    FILE *src;
+    const char *filename;
+    int codec;
+    unsigned char in[DECODE_INPUT];
+    size_t inpos, inlen;
+    int srceof;
+    int pending;        /* the last step filled its output: it may have more */
+    int midstream;      /* a gzip member or zstd frame was started and not ended */
+    const char *error;
+#if GHSS_ZLIB
+    z_stream z;
+#endif
+#if GHSS_ZSTD
+    ZSTD_DStream *zs;
+#endif
+#if GHSS_THREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled, emptied;
+    char *block[DECODE_NBLOCKS];
+    size_t len[DECODE_NBLOCKS];
+    int nfull;          /* blocks decompressed and not yet parsed */
+    int done;           /* the thread decompressed the last block */
+    int stop;           /* the stream was closed before the end */
+    int cur;            /* block being parsed */
+    size_t off;         /* bytes of it already parsed */
+#endif
+} decoder_t;
+
+/* Decompress into OUT what the next input bytes give, at most CAP bytes */
+static size_t
+decode_step (decoder_t *d, char *out, size_t cap)
+{
+    size_t n = 0;
+
+    switch (d->codec) {
+    case CODEC_NONE:
+        n = d->inlen - d->inpos;
+        if (n > cap) n = cap;
+        memcpy (out, d->in + d->inpos, n);
+        d->inpos += n;
+        break;
+#if GHSS_ZLIB
+    case CODEC_GZIP: {
+        int ret;
+        d->z.next_in = d->in + d->inpos;
+        d->z.avail_in = d->inlen - d->inpos;
+        d->z.next_out = (unsigned char *) out;
+        d->z.avail_out = cap;
+        ret = inflate (&d->z, Z_NO_FLUSH);
+        n = cap - d->z.avail_out;
+        d->inpos = d->inlen - d->z.avail_in;
+        if (ret == Z_STREAM_END) {
+            /* concatenated gzip files are decompressed one after the other */
+            inflateReset (&d->z);
+            d->midstream = 0;
+        } else if (ret == Z_OK || ret == Z_BUF_ERROR) {
+            d->midstream = 1;
+        } else {
+            d->error = (d->z.msg) ? d->z.msg : "invalid compressed data";
+        }
+        break;
+    }
+#endif
+#if GHSS_ZSTD
+    case CODEC_ZSTD: {
+        ZSTD_inBuffer ib = { d->in, d->inlen, d->inpos };
+        ZSTD_outBuffer ob = { out, cap, 0 };
+        size_t ret = ZSTD_decompressStream (d->zs, &ob, &ib);
+        if (ZSTD_isError (ret)) {
+            d->error = ZSTD_getErrorName (ret);
+        } else {
+            d->midstream = (ret != 0);
+        }
+        n = ob.pos;
+        d->inpos = ib.pos;
+        break;
+    }
+#endif
+    }
+    d->pending = (n == cap);
+    return n;
+}
+
+/* Fill OUT with up to CAP decompressed bytes. Returns fewer than CAP only
+   at the end of the input or after an error (D->error).  */
+static size_t
+decode (decoder_t *d, char *out, size_t cap)
+{
+    size_t got = 0;
+
+    while (got < cap && !d->error) {
+        if (d->inpos == d->inlen && !d->pending) {
+            if (!d->srceof) {
+                d->inpos = 0;
+                d->inlen = fread (d->in, 1, DECODE_INPUT, d->src);
+                if (d->inlen == 0) {
+                    d->srceof = 1;
+                    if (ferror (d->src))
+                        d->error = strerror (errno);
+                }
+            }
+            if (d->srceof) {
+                if (d->midstream && !d->error)
+                    d->error = "unexpected end of compressed data";
+                break;
+            }
+        }
+        got += decode_step (d, out + got, cap - got);
+    }
+    return got;
+}
+
+static void
+decoder_check (const decoder_t *d)
+{
+    if (d->error)
+        errprintf ("%s: %s: %s", d->filename, codec_name[d->codec], d->error);
+}
+
+#if GHSS_THREADS
+static void *
+decoder_thread (void *arg)
+{
+    decoder_t *d = arg;
+    int i = 0, stop;
+    size_t len;
+
+    do {
+        pthread_mutex_lock (&d->lock);
+        while (d->nfull == DECODE_NBLOCKS && !d->stop)
+            pthread_cond_wait (&d->emptied, &d->lock);
+        stop = d->stop;
+        pthread_mutex_unlock (&d->lock);
+        if (stop)
+            break;
+
+        len = decode (d, d->block[i], DECODE_BLOCK);
+
+        pthread_mutex_lock (&d->lock);
+        d->len[i] = len;
+        d->nfull++;
+        d->done = (len < DECODE_BLOCK);
+        pthread_cond_signal (&d->filled);
+        pthread_mutex_unlock (&d->lock);
+        i = (i + 1) % DECODE_NBLOCKS;
+    } while (len == DECODE_BLOCK);
+    return NULL;
+}
+#endif
+
+static ssize_t
+decoder_read (void *cookie, char *buf, size_t size)
+{
+    decoder_t *d = cookie;
+#if GHSS_THREADS
+    size_t got = 0, n;
+    int nfull;
+
+    while (got < size) {
+        pthread_mutex_lock (&d->lock);
+        while (d->nfull == 0 && !d->done)
+            pthread_cond_wait (&d->filled, &d->lock);
+        nfull = d->nfull;
+        pthread_mutex_unlock (&d->lock);
+        if (nfull == 0)
+            break;
+
+        n = d->len[d->cur] - d->off;
+        if (n > size - got) n = size - got;
+        memcpy (buf + got, d->block[d->cur] + d->off, n);
+        got += n;
+        d->off += n;
+        if (d->off == d->len[d->cur]) {
+            /* give the block back to the thread */
+            pthread_mutex_lock (&d->lock);
+            d->nfull--;
+            pthread_cond_signal (&d->emptied);
+            pthread_mutex_unlock (&d->lock);
+            d->cur = (d->cur + 1) % DECODE_NBLOCKS;
+            d->off = 0;
+        }
+    }
+    if (got == 0)
+        decoder_check (d);
+    return got;
+#else
+    size_t got = decode (d, buf, size);
+    if (got == 0)
+        decoder_check (d);
+    return got;
+#endif
+}
+
+static int
+decoder_close (void *cookie)
+{
+    decoder_t *d = cookie;
+
+#if GHSS_THREADS
+    int i;
+
+    pthread_mutex_lock (&d->lock);
+    d->stop = 1;
+    pthread_cond_signal (&d->emptied);
+    pthread_mutex_unlock (&d->lock);
+    pthread_join (d->thread, NULL);
+    pthread_mutex_destroy (&d->lock);
+    pthread_cond_destroy (&d->filled);
+    pthread_cond_destroy (&d->emptied);
+    for (i = 0; i < DECODE_NBLOCKS; i++)
+        free (d->block[i]);
+#endif
+#if GHSS_ZLIB
+    if (d->codec == CODEC_GZIP)
+        inflateEnd (&d->z);
+#endif
+#if GHSS_ZSTD
+    if (d->codec == CODEC_ZSTD)
+        ZSTD_freeDStream (d->zs);
+#endif
+    if (d->src != stdin)
+        fclose (d->src);
+    free (d);
+    return 0;
+}
+
+#if defined(__GLIBC__)
+static FILE *
+decoder_stream (decoder_t *d)
+{
+    cookie_io_functions_t io = { decoder_read, NULL, NULL, decoder_close };
+    return fopencookie (d, "r", io);
+}
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+static int
+decoder_readfn (void *cookie, char *buf, int size)
+{
+    return decoder_read (cookie, buf, size);
+}
+
+static FILE *
+decoder_stream (decoder_t *d)
+{
+    return funopen (d, decoder_readfn, NULL, NULL, decoder_close);
+}
+#else
+static FILE *
+decoder_stream (decoder_t *d)
+{
+    errprintf ("%s: %s input is not supported on this system",
+               d->filename, codec_name[d->codec]);
+    return NULL;
+}
+#endif
+
+static int
+detect_codec (const unsigned char *magic, size_t n)
+{
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        return CODEC_GZIP;
+    if (n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f
+        && magic[3] == 0xfd)
+        return CODEC_ZSTD;
+    return CODEC_NONE;
+}
+
+/* SRC, or a stream of its decompressed contents if it is compressed.  */
+static FILE *
+open_input (FILE *src, const char *filename)
+{
+    unsigned char magic[4];
+    long pos = ftell (src);
+    size_t n = fread (magic, 1, sizeof(magic), src);
+    int codec = detect_codec (magic, n);
+    decoder_t *d;
+    FILE *f;
+
+    if (codec == CODEC_NONE && pos >= 0 && fseek (src, pos, SEEK_SET) == 0)
+        return src;
+
+#if !GHSS_ZLIB
+    if (codec == CODEC_GZIP)
+        errprintf ("%s: gzip input, but gHSS was built without zlib (make ZLIB=1)", filename);
+#endif
+#if !GHSS_ZSTD
+    if (codec == CODEC_ZSTD)
+        errprintf ("%s: zstd input, but gHSS was built without zstd (make ZSTD=1)", filename);
+#endif
+
+    d = calloc (1, sizeof(decoder_t));
+    d->src = src;
+    d->filename = filename;
+    d->codec = codec;
+    memcpy (d->in, magic, n);
+    d->inlen = n;
+#if GHSS_ZLIB
+    if (codec == CODEC_GZIP && inflateInit2 (&d->z, 15 + 16) != Z_OK)
+        errprintf ("%s: %s", filename, (d->z.msg) ? d->z.msg : "cannot initialize zlib");
+#endif
+#if GHSS_ZSTD
+    if (codec == CODEC_ZSTD && (d->zs = ZSTD_createDStream ()) == NULL)
+        errprintf ("%s: cannot initialize zstd", filename);
+#endif
+
+    f = decoder_stream (d);
+    if (f == NULL)
+        errprintf ("%s: %s", filename, strerror (errno));
+
+#if GHSS_THREADS
+    {
+        int i;
+        for (i = 0; i < DECODE_NBLOCKS; i++)
+            if ((d->block[i] = malloc (DECODE_BLOCK)) == NULL)
+                errprintf ("%s: %s", filename, strerror (errno));
+        pthread_mutex_init (&d->lock, NULL);
+        pthread_cond_init (&d->filled, NULL);
+        pthread_cond_init (&d->emptied, NULL);
+        if (pthread_create (&d->thread, NULL, decoder_thread, d) != 0)
+            errprintf ("%s: cannot start the decompression thread", filename);
+    }
+#endif
+    return f;
+}
+
+static int read_threads = 1;
+
+void
+read_data_set_threads (int nthreads)
+{
+    read_threads = (nthreads > 0) ? nthreads : 1;
+}
+
+#define is_blank(c) ((c) == ' ' || (c) == '\t')
+#define is_newline(c) ((c) == '\n' || (c) == '\r')
+
+#if READ_MMAP
+/* Parallel parsing of (uncompressed) files.
+
+   The file is mapped and split into one chunk per thread, at the start
+   of lines that follow a '\n'. Each chunk is parsed by its own thread
+   into its own buffer: its rows, grouped into runs not separated by an
+   empty (or comment) line, and whether it starts or ends with an empty
+   line, so that the sets that span chunks are stitched back together.
+
+   Lines are counted as the fscanf parser below counts them, which only
+   depends on the line itself: a data row ends at '\n', or at '\r' and
+   the '\n's after it, and an empty or comment line ends at one '\r' or
+   '\n'. A chunk that meets what this parser does not handle exactly as
+   fscanf does (a token that is a number followed by other characters,
+   that fscanf would partly consume, or that starts with other white
+   space) is given up, and the whole file is read by the fscanf parser,
+   so that the error, or the value, is the same.  */
+
+#define CHUNK_MIN (4 << 20)     /* smallest chunk given to a thread */
+
+enum { CHUNK_OK, CHUNK_CONVERT, CHUNK_COLUMNS, CHUNK_GIVEUP };
+
+typedef struct chunk {
+    const char *begin, *end;
+    const char *tail;           /* copy of the last line if it has no newline, or NULL */
+    size_t taillen;
+
+    double *data;
+    size_t ndata, datasize;
+    ghss_index_t *runs;         /* rows in each run of data lines */
+    int nruns, runssize;
+    int gap;                    /* an empty line after the last row */
+    int gap_before;             /* an empty line before the first row */
+
+    ghss_index_t nlines;
+    int ncols;                  /* columns of the first row (0 if none) */
+    ghss_index_t first_line;    /* line of the first row */
+
+    int error;
+    ghss_index_t err_line;
+    int err_column, err_ncols;
+    char err_token[61];
+} chunk_t;
+
+static void
+chunk_push (chunk_t *c, double x)
+{
+    if (c->ndata == c->datasize) {
+        c->datasize = (c->datasize) ? 2 * c->datasize : 4096;
+        c->data = realloc (c->data, c->datasize * sizeof(double));
+        if (c->data == NULL)
+            errprintf ("%s", strerror (errno));
+    }
+    c->data[c->ndata++] = x;
+}
+
+static void
+chunk_row (chunk_t *c)
+{
+    if (c->nruns == 0 || c->gap) {
+        if (c->nruns == 0)
+            c->gap_before = c->gap;
+        if (c->nruns == c->runssize) {
+            c->runssize = (c->runssize) ? 2 * c->runssize : 64;
+            c->runs = realloc (c->runs, c->runssize * sizeof(ghss_index_t));
+            if (c->runs == NULL)
+                errprintf ("%s", strerror (errno));
+        }
+        c->runs[c->nruns++] = 0;
+        c->gap = 0;
+    }
+    c->runs[c->nruns - 1]++;
+}
+
+/* Parse the lines in [P, END), the last of which ends with a newline */
+static void
+parse_lines (chunk_t *c, const char *p, const char *end)
+{
+    const char *q, *e;
+    int column;
+    double x;
+
+    while (p < end && c->error == CHUNK_OK) {
+        c->nlines++;
+        q = p;
+        if (*q != '#')
+            while (is_blank (*q)) q++;
+        if ((q == p && *q == '#') || is_newline (*q)) {
+            /* empty or comment line */
+            while (!is_newline (*q)) q++;
+            p = q + 1;
+            c->gap = 1;
+            continue;
+        }
+
+        for (column = 1; ; column++) {
+            /* strtod (and fscanf) would skip other white space, newlines included */
+            if (*q == '\v' || *q == '\f') {
+                c->error = CHUNK_GIVEUP;
+                return;
+            }
+            x = strtod (q, (char **) &e);
+            if (e == q || !(is_blank (*e) || is_newline (*e))) {
+                /* only the tokens that cannot start a number are reported here */
+                if (e == q && *q != '\0' && !strchr ("0123456789+-.iInN", *q)) {
+                    int i;
+                    c->error = CHUNK_CONVERT;
+                    c->err_line = c->nlines;
+                    c->err_column = column;
+                    for (i = 0; i < 60 && !is_blank (q[i]) && !is_newline (q[i]); i++)
+                        c->err_token[i] = q[i];
+                    c->err_token[i] = '\0';
+                } else {
+                    c->error = CHUNK_GIVEUP;
+                }
+                return;
+            }
+            chunk_push (c, x);
+            for (q = e; is_blank (*q); q++);
+            if (*q == '\n') {
+                q++;
+                break;
+            }
+            if (*q == '\r') {
+                for (q++; q < end && *q == '\n'; q++);
+                break;
+            }
+        }
+
+        if (c->ncols == 0) {
+            c->ncols = column;
+            c->first_line = c->nlines;
+        } else if (column != c->ncols) {
+            c->error = CHUNK_COLUMNS;
+            c->err_line = c->nlines;
+            c->err_ncols = column;
+            return;
+        }
+        chunk_row (c);
+        p = q;
+    }
+}
+
+static void *
+parse_chunk (void *arg)
+{
+    chunk_t *c = arg;
+
+    c->datasize = (c->end - c->begin) / 8 + 1;
+    c->data = malloc (c->datasize * sizeof(double));
+    if (c->data == NULL)
+        errprintf ("%s", strerror (errno));
+    parse_lines (c, c->begin, c->end);
+    if (c->tail)
+        parse_lines (c, c->tail, c->tail + c->taillen);
+    return NULL;
+}
+
+/* Chunk boundary: the first line start at or after P that follows a
+   '\n' and does not start with a newline.  */
+static const char *
+next_line (const char *p, const char *begin, const char *end)
+{
+    for (; p < end; p++)
+        if (p > begin && p[-1] == '\n' && !is_newline (*p))
+            return p;
+    return end;
+}
+
+/* Parse FILENAME in parallel, as read_data does for a new set of points.
+   Returns 0 (the file was read) or an error code of read_data, or 1 if
+   the file must be read by the fscanf parser instead.  */
+static int
+read_data_mapped (const char *filename, arena_t *arena, double **data_p,
+                  int *nobjs_p, ghss_index_t **cumsizes_p, int *nsets_p)
+{
+    int fd = open (filename, O_RDONLY);
+    struct stat st;
+    const char *map, *end, *tail;
+    char *tailcopy = NULL;
+    chunk_t *chunk;
+    int nchunks, i, j, ret = 1;
+    int nobjs = *nobjs_p, nsets = 0, gap = 0;
+    ghss_index_t nrows = 0, line = 0;
+    ghss_index_t *cumsizes = NULL;
+    double *data;
+    size_t ndata = 0;
+
+    if (fd < 0)
+        return 1;
+    if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_size == 0) {
+        close (fd);
+        return 1;
+    }
+    map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED)
+        return 1;
+    end = map + st.st_size;
+    if ((unsigned char) map[0] == 0x1f || (st.st_size >= 4 && !memcmp (map, "\x28\xb5\x2f\xfd", 4))) {
+        /* compressed */
+        munmap ((void *) map, st.st_size);
+        return 1;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise ((void *) map, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    /* the last line is copied if it does not end with a newline, so that
+       strtod never reads past the end of the map */
+    for (tail = end; tail > map && !is_newline (tail[-1]); tail--);
+
+    nchunks = st.st_size / CHUNK_MIN + 1;
+#if GHSS_THREADS
+    if (nchunks > read_threads) nchunks = read_threads;
+#else
+    nchunks = 1;
+#endif
+    chunk = calloc (nchunks, sizeof(chunk_t));
+    chunk[0].begin = map;
+    for (i = 1, j = 0; i < nchunks; i++) {
+        const char *p = next_line (map + (size_t) (st.st_size / nchunks) * i,
+                                   map, tail);
+        if (p == tail || p <= chunk[j].begin)
+            continue;
+        chunk[j].end = p;
+        chunk[++j].begin = p;
+    }
+    nchunks = j + 1;
+    chunk[j].end = tail;
+    if (tail < end) {
+        chunk[j].taillen = end - tail + 1;
+        chunk[j].tail = tailcopy = malloc (chunk[j].taillen + 1);
+        memcpy (tailcopy, tail, end - tail);
+        tailcopy[end - tail] = '\n';
+        tailcopy[end - tail + 1] = '\0';
+    }
+
+#if GHSS_THREADS
+    {
+        pthread_t thread[nchunks];
+        int started[nchunks];
+        for (i = 1; i < nchunks; i++) {
+            started[i] = (pthread_create (&thread[i], NULL, parse_chunk, &chunk[i]) == 0);
+            if (!started[i])
+                parse_chunk (&chunk[i]);
+        }
+        parse_chunk (&chunk[0]);
+        for (i = 1; i < nchunks; i++)
+            if (started[i])
+                pthread_join (thread[i], NULL);
+    }
+#else
+    parse_chunk (&chunk[0]);
+#endif
+
+    /* check the chunks in order, so that the first error is reported */
+    for (i = 0; i < nchunks; i++) {
+        chunk_t *c = &chunk[i];
+        if (c->error == CHUNK_GIVEUP)
+            goto finish;
+        if (c->ncols) {
+            if (!nobjs) {
+                nobjs = c->ncols;
+            } else if (c->ncols != nobjs) {
+                if (nrows == 0) {
+                    errprintf ("%s: line %" GHSS_PRIindex ": input has dimension %d"
+                               " while reference point has dimension %d",
+                               filename, line + c->first_line, c->ncols, nobjs);
+                    ret = READ_INPUT_WRONG_INITIAL_DIM;
+                    goto finish;
+                }
+                errprintf ("%s: line %" GHSS_PRIindex " has different number of columns (%d)"
+                           " from first row (%d)\n",
+                           filename, line + c->first_line, c->ncols, nobjs);
+            }
+        }
+        if (c->error == CHUNK_CONVERT)
+            errprintf ("%s: line %" GHSS_PRIindex " column %d: "
+                       "could not convert string `%s' to double",
+                       filename, line + c->err_line, c->err_column, c->err_token);
+        if (c->error == CHUNK_COLUMNS)
+            errprintf ("%s: line %" GHSS_PRIindex " has different number of columns (%d)"
+                       " from first row (%d)\n",
+                       filename, line + c->err_line, c->err_ncols, nobjs);
+        line += c->nlines;
+        ndata += c->ndata;
+        for (j = 0; j < c->nruns; nrows += c->runs[j], j++)
+            nsets += (j > 0 || nrows == 0 || gap || c->gap_before);
+        if (c->nruns)
+            gap = c->gap;
+        else
+            gap = gap || c->gap;
+    }
+    if (nrows == 0) {
+        ret = READ_INPUT_FILE_EMPTY;
+        goto finish;
+    }
+
+    /* stitch the chunks into DATA and CUMSIZES */
+    data = arena_alloc (arena, ndata * sizeof(double));
+    cumsizes = malloc (nsets * sizeof(ghss_index_t));
+    if (data == NULL || cumsizes == NULL)
+        errprintf ("%s: %s", filename, strerror (errno));
+    nsets = 0;
+    nrows = 0;
+    gap = 0;
+    ndata = 0;
+    for (i = 0; i < nchunks; i++) {
+        chunk_t *c = &chunk[i];
+        memcpy (data + ndata, c->data, c->ndata * sizeof(double));
+        ndata += c->ndata;
+        free (c->data);
+        c->data = NULL;
+        for (j = 0; j < c->nruns; j++) {
+            if (j > 0 || nrows == 0 || gap || c->gap_before)
+                cumsizes[nsets++] = nrows;
+            nrows += c->runs[j];
+            cumsizes[nsets - 1] = nrows;
+        }
+        if (c->nruns)
+            gap = c->gap;
+        else
+            gap = gap || c->gap;
+    }
+
+    *data_p = data;
+    *nobjs_p = nobjs;
+    *cumsizes_p = cumsizes;
+    *nsets_p = nsets;
+    ret = 0;
+
+finish:
+    for (i = 0; i < nchunks; i++) {
+        free (chunk[i].data);
+        free (chunk[i].runs);
+    }
+    free (chunk);
+    free (tailcopy);
+    munmap ((void *) map, st.st_size);
+    return ret;
+}
+#endif
+
+/* The points are kept in ARENA, in which DATA_P must be the last block
+   allocated (if not NULL), so that it grows in place.  */
 int
-read_data (const char *filename, double **data_p, 
-           int *nobjs_p, int **cumsizes_p, int *nsets_p)
+read_data (const char *filename, arena_t *arena, double **data_p,
+           int *nobjs_p, ghss_index_t **cumsizes_p, int *nsets_p)
 {
     FILE *instream;
 
     int nobjs = *nobjs_p;        /* number of objectives (and columns).  */
-    int *cumsizes = *cumsizes_p; /* cumulative sizes of data sets.       */
+    ghss_index_t *cumsizes = *cumsizes_p; /* cumulative sizes of data sets. */
     int nsets    = *nsets_p;     /* number of data sets.                 */
     double *data = *data_p;
 
@@ -53,15 +774,25 @@ read_data (const char *filename, double **data_p,
 
     int retval;			/* return value for fscanf */
     char newline[2];
-    int ntotal;			/* the current element of (*datap) */
+    size_t ntotal;		/* the current element of (*datap) */
 
-    int column, line;
+    int column;
+    ghss_index_t line;
 
-    int datasize;
+    size_t datasize;
     int sizessize;
 
     int error = 0;
 
+#if READ_MMAP
+    if (filename != NULL && nsets == 0 && data == NULL) {
+        error = read_data_mapped (filename, arena, data_p, nobjs_p, cumsizes_p, nsets_p);
+        if (error != 1)
+            return error;
+        error = 0;
+    }
+#endif
+
     if (filename == NULL) {
         instream = stdin;
         filename = "<stdin>"; /* used to diagnose errors.  */
@@ -70,21 +801,23 @@ read_data (const char *filename, double **data_p,
         errprintf ("%s: %s\n", filename, strerror (errno));
         exit (EXIT_FAILURE);
     }
+    instream = open_input (instream, filename);
 
     if (nsets == 0) {
         ntotal = 0;
         sizessize = 0;
         datasize = 0;
     } else {
-        ntotal = nobjs * cumsizes[nsets - 1];
+        ntotal = (size_t) nobjs * cumsizes[nsets - 1];
         sizessize = ((nsets - 1) / DATA_INC + 1) * DATA_INC;
         datasize  = ((ntotal - 1) / DATA_INC + 1) * DATA_INC;
     }
 
     /* if size is equal to zero, this is equivalent to free().  
        That is, reinitialize the data structures.  */
-    cumsizes = realloc (cumsizes, sizessize * sizeof(int));
-    data = realloc (data, datasize * sizeof(double));
+    cumsizes = realloc (cumsizes, sizessize * sizeof(ghss_index_t));
+    data = arena_realloc (arena, data, ntotal * sizeof(double),
+                          datasize * sizeof(double));
 
     column = 0;
     line = 0;
@@ -108,7 +841,7 @@ read_data (const char *filename, double **data_p,
         /* beginning of data set */
 	if (nsets == sizessize) {
             sizessize += DATA_INC;
-	    cumsizes = realloc (cumsizes, sizessize * sizeof(int));
+	    cumsizes = realloc (cumsizes, sizessize * sizeof(ghss_index_t));
         }
 
 	cumsizes[nsets] = (nsets == 0) ? 0 : cumsizes[nsets - 1];
@@ -124,7 +857,7 @@ read_data (const char *filename, double **data_p,
                 if (fscanf (instream, "%lf", &number) != 1) {
                     char buffer[64];
                     fscanf (instream, "%60[^ \t\r\n]", buffer);
-                    errprintf ("%s: line %d column %d: "
+                    errprintf ("%s: line %" GHSS_PRIindex " column %d: "
                                "could not convert string `%s' to double", 
                                filename, line, column, buffer);
                     exit (EXIT_FAILURE);
@@ -132,13 +865,14 @@ read_data (const char *filename, double **data_p,
 
                 if (ntotal == datasize) {
                     datasize += DATA_INC;
-                    data = realloc (data, datasize * sizeof(double));
+                    data = arena_realloc (arena, data, ntotal * sizeof(double),
+                                          datasize * sizeof(double));
                 }
                 data[ntotal] = number;
                 ntotal++;
 
 #if DEBUG > 1
-                fprintf (stderr, "%s:%d:%d(%d) %d (set %d) = "
+                fprintf (stderr, "%s:%" GHSS_PRIindex ":%d(%d) %" GHSS_PRIindex " (set %d) = "
                          point_printf_format "\n", 
                         filename, line, column, nobjs, 
                         cumsizes[nsets], nsets, (double)number);
@@ -156,13 +890,13 @@ read_data (const char *filename, double **data_p,
             else if (column == nobjs)
                 ; /* OK */
             else if (cumsizes[0] == 0) { /* just finished first row.  */
-                errprintf ("%s: line %d: input has dimension %d"
+                errprintf ("%s: line %" GHSS_PRIindex ": input has dimension %d"
                            " while reference point has dimension %d",
                            filename, line, column, nobjs);
                 error = READ_INPUT_WRONG_INITIAL_DIM;
                 goto read_data_finish;
             } else {
-                errprintf ("%s: line %d has different number of columns (%d)"
+                errprintf ("%s: line %" GHSS_PRIindex " has different number of columns (%d)"
                            " from first row (%d)\n", 
                            filename, line, column, nobjs);
                 exit (EXIT_FAILURE);
@@ -180,7 +914,7 @@ read_data (const char *filename, double **data_p,
 	nsets++; /* new data set */
 
 #if DEBUG > 1
-	fprintf (stderr, "%s: set %d, read %d rows\n", 
+	fprintf (stderr, "%s: set %d, read %" GHSS_PRIindex " rows\n", 
                  filename, nsets, cumsizes[nsets - 1]);
 #endif
         /* skip over successive empty lines */
@@ -194,8 +928,9 @@ read_data (const char *filename, double **data_p,
     } while (retval != EOF); /* faster than !feof() */
 
     /* adjust to real size (saves memory but probably slower).  */
-    cumsizes = realloc (cumsizes, nsets * sizeof(int));
-    data = realloc (data, ntotal * sizeof(double));
+    cumsizes = realloc (cumsizes, nsets * sizeof(ghss_index_t));
+    data = arena_realloc (arena, data, datasize * sizeof(double),
+                          ntotal * sizeof(double));
 
 read_data_finish:
 
@@ -210,6 +945,176 @@ read_data_finish:
     return error;
 }
 
+/* Reading a set of points a chunk at a time (see read_stream_points).
+   As in read_data, empty and comment lines separate sets, but lines end
+   only at '\n' (a '\r' before it is ignored).  */
+
+struct read_stream {
+    FILE *f;
+    const char *filename;
+    char *line;
+    size_t linesize;
+    ghss_index_t nline;         /* lines read */
+    ghss_index_t nrows;         /* data rows read */
+    bool pending;               /* LINE holds a data row not parsed yet */
+    bool eof;
+};
+
+/* Read the next line into S->line. Returns false at the end of the input.  */
+static bool
+stream_getline (read_stream_t *s)
+{
+    if (getline (&s->line, &s->linesize, s->f) < 0)
+        return false;
+    s->nline++;
+    return true;
+}
+
+static bool
+is_separator (const char *line)
+{
+    if (*line == '#')
+        return true;
+    while (is_blank (*line))
+        line++;
+    return *line == '\0' || is_newline (*line);
+}
+
+/* Skip separators up to the next data row (or the end of the input) */
+static void
+stream_skip (read_stream_t *s)
+{
+    while (!s->pending && !s->eof) {
+        if (!stream_getline (s))
+            s->eof = true;
+        else if (!is_separator (s->line))
+            s->pending = true;
+    }
+}
+
+read_stream_t *
+read_stream_open (const char *filename)
+{
+    read_stream_t *s = calloc (1, sizeof(read_stream_t));
+    FILE *f;
+
+    if (filename == NULL) {
+        f = stdin;
+        filename = "<stdin>";
+    } else if (NULL == (f = fopen (filename, "r"))) {
+        errprintf ("%s: %s\n", filename, strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+    s->f = open_input (f, filename);
+    s->filename = filename;
+    stream_skip (s);
+    return s;
+}
+
+bool
+read_stream_eof (const read_stream_t *s)
+{
+    return s->eof;
+}
+
+/* Parse the data row in S->line into DATA */
+static void
+stream_row (read_stream_t *s, double *data, int *nobjs_p)
+{
+    char *p = s->line, *e;
+    int column = 0;
+    int ncols = (*nobjs_p) ? *nobjs_p : READ_STREAM_MAXOBJ;
+    double x;
+
+    for (;;) {
+        while (is_blank (*p))
+            p++;
+        if (*p == '\0' || is_newline (*p))
+            break;
+        column++;
+        x = strtod (p, &e);
+        if (e == p || !(is_blank (*e) || is_newline (*e) || *e == '\0')) {
+            char buffer[61];
+            int i;
+            for (i = 0; i < 60 && p[i] && !is_blank (p[i]) && !is_newline (p[i]); i++)
+                buffer[i] = p[i];
+            buffer[i] = '\0';
+            errprintf ("%s: line %" GHSS_PRIindex " column %d: "
+                       "could not convert string `%s' to double",
+                       s->filename, s->nline, column, buffer);
+            exit (EXIT_FAILURE);
+        }
+        if (column <= ncols)
+            data[column - 1] = x;
+        p = e;
+    }
+
+    if (*nobjs_p == 0 && column > READ_STREAM_MAXOBJ) {
+        errprintf ("%s: line %" GHSS_PRIindex ": input has dimension %d, but at most %d"
+                   " coordinates are read a chunk at a time", s->filename, s->nline,
+                   column, READ_STREAM_MAXOBJ);
+        exit (EXIT_FAILURE);
+    } else if (*nobjs_p == 0) {
+        *nobjs_p = column;
+    } else if (column != *nobjs_p && s->nrows == 0) {
+        errprintf ("%s: line %" GHSS_PRIindex ": input has dimension %d"
+                   " while reference point has dimension %d",
+                   s->filename, s->nline, column, *nobjs_p);
+        exit (EXIT_FAILURE);
+    } else if (column != *nobjs_p) {
+        errprintf ("%s: line %" GHSS_PRIindex " has different number of columns (%d)"
+                   " from first row (%d)\n", s->filename, s->nline, column, *nobjs_p);
+        exit (EXIT_FAILURE);
+    }
+    s->nrows++;
+}
+
+ghss_index_t
+read_stream_points (read_stream_t *s, double *data, ghss_index_t max,
+                    int *nobjs_p, bool *end_p)
+{
+    ghss_index_t n = 0;
+
+    *end_p = false;
+    while (n < max) {
+        if (!s->pending) {
+            if (!stream_getline (s)) {
+                s->eof = true;
+                *end_p = true;
+                break;
+            }
+            if (is_separator (s->line)) {
+                *end_p = true;
+                break;
+            }
+        }
+        s->pending = false;
+        stream_row (s, data + (size_t) n * *nobjs_p, nobjs_p);
+        n++;
+    }
+    /* so that the end of the set, and of the input, are known as soon as possible */
+    if (!*end_p && !s->pending) {
+        if (!stream_getline (s))
+            s->eof = *end_p = true;
+        else if (is_separator (s->line))
+            *end_p = true;
+        else
+            s->pending = true;
+    }
+    if (*end_p)
+        stream_skip (s);
+    return n;
+}
+
+void
+read_stream_close (read_stream_t *s)
+{
+    if (s->f != stdin)
+        fclose (s->f);
+    free (s->line);
+    free (s);
+}
+
 /* From:
 
    Edition 0.10, last updated 2001-07-06, of `The GNU C Library
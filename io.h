@@ -1,10 +1,14 @@
 #ifndef _GHSS_IO_H_
 #define _GHSS_IO_H_
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
 
+#include "arena.h"
+#include "gHSS.h"
+
 #define point_printf_format "%-16.15g"
 
 /* If we're not using GNU C, elide __attribute__ */
@@ -26,7 +30,33 @@ void warnprintf(const char *template,...)
 #define READ_INPUT_WRONG_INITIAL_DIM -2
 
 int
-read_data (const char *filename, double **data_p, 
-           int *nobjs_p, int **cumsizes_p, int *nsets_p);
+read_data (const char *filename, arena_t *arena, double **data_p,
+           int *nobjs_p, ghss_index_t **cumsizes_p, int *nsets_p);
+
+/* Number of threads that parse a file in read_data (1 by default) */
+void read_data_set_threads (int nthreads);
+
+/* Points read a chunk at a time, for inputs that do not fit in memory */
+typedef struct read_stream read_stream_t;
+
+/* Most coordinates of a point read by read_stream_points */
+#define READ_STREAM_MAXOBJ 3
+
+/* Open FILENAME (standard input if NULL), which may be compressed as for
+   read_data. Errors are reported and exit.  */
+read_stream_t *read_stream_open (const char *filename);
+
+/* Read up to MAX points of the current set into DATA (room for MAX
+   points of *NOBJS_P coordinates, or READ_STREAM_MAXOBJ if *NOBJS_P is
+   0, in which case it is set from the first row). Returns the number of
+   points read and sets *END_P if the set ended after them. Errors in the
+   input are reported and exit.  */
+ghss_index_t read_stream_points (read_stream_t *s, double *data, ghss_index_t max,
+                                 int *nobjs_p, bool *end_p);
+
+/* Whether no set is left to read */
+bool read_stream_eof (const read_stream_t *s);
+
+void read_stream_close (read_stream_t *s);
 
 #endif
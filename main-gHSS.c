@@ -41,6 +41,10 @@
 #include "io.h"
 #include "gHSS.h"
 #include "timer.h"
+#include "serve.h"
+#include "cache.h"
+#include "output.h"
+#include "stream.h"
 
 #include <errno.h>
 #include <stdlib.h>
@@ -52,6 +56,7 @@
 #include <unistd.h>  // for getopt()
 #include <getopt.h> // for getopt_long()
 #include <limits.h>
+#include <sys/stat.h>
 
 #ifdef __USE_GNU
 extern char *program_invocation_short_name;
@@ -63,8 +68,27 @@ static const char * const stdin_name = "<stdin>";
 static int verbose_flag = 1;
 static bool union_flag = false;
 static char *suffix = NULL;
-static int ksub = -1;
-static int outflag = 0; //0 - index and hypervolume (default), 1 - index, 2 - hypervolume, 3 - index and contribution, 4 - accumulated contribution
+static ghss_index_t ksub = -1;
+static int outflag = 0; //0 - index and hypervolume (default), 1 - index, 2 - hypervolume, 3 - index and contribution, 4 - accumulated contribution, 5 - binary, 6 - as 3 and the contributions of the points not selected
+#define OUTPUT_BINARY_FLAG 5
+#define OUTPUT_REMAINING_FLAG 6
+static bool shortest_flag = false; //print the shortest digits that read back as the same double
+static bool stats_flag = false;
+static int timings_flag = 0; //0 - none, 1 - JSON, 2 - TSV
+static int arena_flags = 0; //GHSS_ARENA_* flags, also used for the points read
+static arena_t *input_arena = NULL; //points of the file being processed
+static int nrefs = 0; //number of reference points given with -r and -R
+static bool serve_flag = false;
+static char *serve_path = NULL; //Unix domain socket of --serve (NULL: stdin/stdout)
+static char *cache_suffix = NULL; //suffix of the sidecar files of --cache (NULL: no cache)
+static char *memory_limit = NULL; //argument of --memory-limit (NULL: each FILE is read at once)
+static ghss_index_t stream_chunk = 0; //points per chunk of --memory-limit
+static ghss_index_t candidates = 0; //points kept from each chunk by --memory-limit (0: k)
+
+/* options without a short version */
+enum { STATS_OPTION = 256, REFERENCE_FILE_OPTION, TIMINGS_OPTION, REUSE_ARENA_OPTION, PREFAULT_OPTION,
+       SERVE_OPTION, CACHE_OPTION, SHORTEST_OPTION, LAYOUT_OPTION, MEMORY_LIMIT_OPTION,
+       CANDIDATES_OPTION };
 
 
 static void usage(void)
@@ -86,7 +110,10 @@ static void usage(void)
 " -r, --reference=POINT use POINT as the reference point. POINT must be within\n"
 "                      quotes, e.g., \"10 10 10\". If no reference point is  \n"
 "                      given, it is taken as the coordinate-wise maximum of  \n"
-"                      all input points.                                     \n"
+"                      all input points. If -r is given more than once, the \n"
+"                      points are selected for each reference point.         \n"
+"     --reference-file=FILE read reference points from FILE, one per line, as\n"
+"                      if each one was given with -r.                        \n"
 /*
 "                      given, it is taken as max + 0.1 * (max - min) for each\n"
 "                      coordinate from the union of all input points.        \n"
@@ -96,7 +123,7 @@ static void usage(void)
 "                      If missing, output is sent to stdout.                 \n"
 " -k, --subsetsize=k   select k points (a value between 1 and n, where n is  \n"
 "                      the size of the input data set. The default is n/2)   \n"                     
-" -f, --format=(0|..|4) output format                                        \n"
+" -f, --format=(0|..|6) output format                                        \n"
 "                      (0: print indices followed by the hypervolume         \n"
 "                         indicator of the selected subset (default))        \n"
 "                      (1: print indices of the selected points)             \n"
@@ -106,10 +133,124 @@ static void usage(void)
 "                         to the previous subset)                            \n"
 "                      (4: print indices and the corresponding accumulated   \n"
 "                         hypervolume)                                       \n"
+"                      (5 or binary: write, for each set and reference point,\n"
+"                         a header, the indices and the contributions as in \n"
+"                         3, in the byte order of the machine)               \n"
+"                      (6: print indices and contributions as in 3, followed \n"
+"                         by the index and the contribution to the subset    \n"
+"                         selected of each point not selected; uses the list \n"
+"                         engine and one reference point)                    \n"
+"     --shortest       print each number with the fewest digits that read   \n"
+"                      back as the same double, instead of 15 digits        \n"
+    );
+    printf(
+" -t, --threads=N      use up to N threads (at most 3 are used) to update the \n"
+"                      contributions after each selection in 3D (default 1)  \n"
+"                      and to parse each FILE; each thread that updates the  \n"
+"                      contributions keeps its own copy of the points        \n"
+" -e, --engine=NAME    algorithm used to select the points                   \n"
+"                      (auto: the fastest one for the dimension and k        \n"
+"                         (default); lazy in 3D for small k)                 \n"
+"                      (list: gHSS2D/gHSS3D on doubly linked lists)          \n"
+"                      (array: 2D only, nondominated points kept in arrays)  \n"
+"                      (tree: 2D only, O((n + k) log n) with a segment tree; \n"
+"                         near-ties may be broken differently)               \n"
+"                      (lazy: 3D only, for small k, the contributions are    \n"
+"                         only computed for the best candidates; they may    \n"
+"                         differ from list in the last digits, and near-ties \n"
+"                         may be broken differently)                         \n"
+"     --layout=NAME    order of the points in memory for the list engine     \n"
+"                      (input: the order of the input (default))             \n"
+"                      (axis: ascending order of the last coordinate)        \n"
+"                      (zorder: Z-order of the ranks along each axis)        \n"
+    );
+    printf(
+"     --stats          print to stderr the operations counted in each data   \n"
+"                      set (requires a build with make STATS=1)              \n"
+"     --timings[=json|tsv] print to stderr the wall-clock and CPU time of   \n"
+"                      each phase (read, reference, setup, selection and     \n"
+"                      output), one phase per line (default json)            \n"
+"     --reuse-arena    keep the memory used for one data set for the next    \n"
+"                      ones, instead of returning it to the system           \n"
+"     --prefault       fault in the memory (in huge pages, if the system     \n"
+"                      allows it) as soon as it is allocated                 \n"
+"     --cache[=SUFFIX] keep the points of each FILE, parsed and sorted, in the\n"
+"                      sidecar file FILE.ghss (or FILE followed by SUFFIX)   \n"
+"                      and use it instead of FILE while FILE is unchanged    \n"
+"     --memory-limit=SIZE read each set SIZE bytes (with the suffix k, M or G)\n"
+"                      at a time and keep the best candidates of each chunk, \n"
+"                      so that sets larger than the memory can be read       \n"
+"                      (requires -k and one reference point, and -r when     \n"
+"                      reading standard input; see README)                   \n"
+"     --candidates=M   points kept from each chunk with --memory-limit       \n"
+"                      (default k)                                           \n"
+"     --serve[=SOCKET] stay resident and answer requests read from stdin (or \n"
+"                      from the connections to the Unix domain socket SOCKET)\n"
+"                      instead of reading files (see README)                 \n"
 "\n");
 
 }
 
+static void print_stats(const char *filename, int nrun)
+{
+    ghss_stats_t stats;
+    int b, last;
+
+    gHSS_get_stats (&stats);
+
+    fprintf (stderr, "# stats: %s (set %d)\n", filename, nrun + 1);
+    fprintf (stderr, "#   iterations          %llu\n", stats.iterations);
+    fprintf (stderr, "#   argmax calls        %llu\n", stats.argmax_calls);
+    fprintf (stderr, "#   argmax entries      %llu\n", stats.argmax_entries);
+    fprintf (stderr, "#   updateOut passes    %llu\n", stats.updateout_passes);
+    fprintf (stderr, "#   sweep nodes         %llu\n", stats.sweep_nodes);
+    fprintf (stderr, "#   createFloor nodes   %llu\n", stats.floor_nodes);
+    fprintf (stderr, "#   computeArea nodes   %llu\n", stats.area_nodes);
+    fprintf (stderr, "#   bases nodes         %llu\n", stats.bases_nodes);
+    fprintf (stderr, "#   cutOffPartial calls %llu\n", stats.cutoff_calls);
+    fprintf (stderr, "#   cutOffPartial nodes %llu\n", stats.cutoff_nodes);
+    fprintf (stderr, "#   out points updated  %llu\n", stats.reupdated);
+    fprintf (stderr, "#   dominated skipped   %llu\n", stats.dominated_skipped);
+    fprintf (stderr, "#   dominated unlinked  %llu\n", stats.unlinked);
+
+    for (last = GHSS_STATS_BUCKETS - 1; last > 0 && stats.latency[last] == 0; last--);
+    fprintf (stderr, "#   iteration latency (ns):\n");
+    for (b = 0; b <= last; b++) {
+        if (stats.latency[b])
+            fprintf (stderr, "#     [%llu, %llu)\t%llu\n", 1ULL << b, 2ULL << b, stats.latency[b]);
+    }
+}
+
+/* one line per phase; 'set' is 0 for the phases done once per file */
+static void print_timing(const char *filename, int set, ghss_index_t size, ghss_index_t k,
+                         const char *phase, double wall, double cpu)
+{
+    static bool header = false;
+    const char *c;
+
+    if (timings_flag == 2) {
+        if (!header) {
+            fprintf (stderr, "file\tset\tn\tk\tphase\twall\tcpu\n");
+            header = true;
+        }
+        fprintf (stderr, "%s\t%d\t%" GHSS_PRIindex "\t%" GHSS_PRIindex "\t%s\t%.9f\t%.9f\n",
+                 filename, set, size, k, phase, wall, cpu);
+        return;
+    }
+
+    fprintf (stderr, "{\"file\": \"");
+    for (c = filename; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            fprintf (stderr, "\\%c", *c);
+        else if ((unsigned char) *c < 0x20)
+            fprintf (stderr, "\\u%04x", *c);
+        else
+            fputc (*c, stderr);
+    }
+    fprintf (stderr, "\", \"set\": %d, \"n\": %" GHSS_PRIindex ", \"k\": %" GHSS_PRIindex ", \"phase\": \"%s\", "
+             "\"wall\": %.9f, \"cpu\": %.9f}\n", set, size, k, phase, wall, cpu);
+}
+
 static void version(void)
 {
     printf("%s version " VERSION
@@ -171,6 +312,79 @@ read_reference(char * str, int *nobj)
     return reference;
 }
 
+/* Append the reference point STR to the NREFS points in *REFERENCE_P */
+static void
+add_reference (double **reference_p, int *nobj_p, char *str,
+               const char *source, int line)
+{
+    int dim;
+    double *point = read_reference (str, &dim);
+
+    if (point == NULL) {
+        if (line)
+            errprintf ("%s: line %d: invalid reference point", source, line);
+        else
+            errprintf ("invalid reference point '%s'", str);
+        exit (EXIT_FAILURE);
+    }
+    if (nrefs > 0 && dim != *nobj_p) {
+        errprintf ("reference points of different dimensions (%d and %d)",
+                   *nobj_p, dim);
+        exit (EXIT_FAILURE);
+    }
+    *reference_p = realloc (*reference_p, (nrefs + 1) * dim * sizeof(double));
+    memcpy (*reference_p + nrefs * dim, point, dim * sizeof(double));
+    free (point);
+    *nobj_p = dim;
+    nrefs++;
+}
+
+/* Add the reference points in FILENAME, one per line */
+static void
+read_reference_file (double **reference_p, int *nobj_p, const char *filename)
+{
+    FILE *stream = fopen (filename, "r");
+    char *line = NULL;
+    size_t size = 0;
+    int n = 0;
+
+    if (stream == NULL) {
+        errprintf ("%s: %s\n", filename, strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+    while (getline (&line, &size, stream) >= 0) {
+        char *c = line + strspn (line, " \t\r\n");
+        n++;
+        if (*c == '\0' || *c == '#')
+            continue;
+        add_reference (reference_p, nobj_p, line, filename, n);
+    }
+    free (line);
+    fclose (stream);
+}
+
+/* a number of bytes, optionally followed by k, M or G (powers of 1024) */
+static size_t
+parse_size (const char *str, const char *option)
+{
+    char *end;
+    unsigned long long size;
+
+    errno = 0;
+    size = strtoull (str, &end, 10);
+    switch (*end) {
+    case 'G': size *= 1024;     /* fall through */
+    case 'M': size *= 1024;     /* fall through */
+    case 'k': size *= 1024; end++;
+    default: break;
+    }
+    if (errno != 0 || end == str || *end != '\0' || !isdigit ((unsigned char) *str)) {
+        errprintf ("invalid size '%s' in %s", str, option);
+        exit (EXIT_FAILURE);
+    }
+    return (size_t) size;
+}
+
 static inline void
 handle_read_data_error (int err, const char *filename)
 {
@@ -191,21 +405,22 @@ handle_read_data_error (int err, const char *filename)
 
 static void
 data_range (double **maximum, double **minimum,
-            const double *data, int nobj, int rows)
+            const double *data, int nobj, ghss_index_t rows)
 {
-    int n, k = 0;
-    int r = 0;
+    int n;
+    size_t k = 0;
+    ghss_index_t r = 0;
 
     if (*maximum == NULL) {
         *maximum = malloc (nobj*sizeof(double));
-        for (k = 0; k < nobj; k++)
+        for (k = 0; k < (size_t) nobj; k++)
             (*maximum)[k] = data[k];
         r = 1;
     }
 
     if (*minimum == NULL) {
         *minimum = malloc (nobj*sizeof(double));
-        for (k = 0; k < nobj; k++)
+        for (k = 0; k < (size_t) nobj; k++)
             (*minimum)[k] = data[k];
         r = 1;
     }
@@ -225,14 +440,14 @@ file_range (const char *filename, double **maximum_p, double **minimum_p,
             int *dim_p)
 {
     double *data = NULL;
-    int *cumsizes = NULL;
+    ghss_index_t *cumsizes = NULL;
     int nruns = 0;
     int dim = *dim_p;
     double *maximum = *maximum_p;
     double *minimum = *minimum_p;
 
     handle_read_data_error (
-        read_data (filename, &data, &dim, &cumsizes, &nruns), filename);
+        read_data (filename, input_arena, &data, &dim, &cumsizes, &nruns), filename);
 
     data_range (&maximum, &minimum, data, dim, cumsizes[nruns-1]);
 
@@ -240,14 +455,293 @@ file_range (const char *filename, double **maximum_p, double **minimum_p,
     *maximum_p = maximum;
     *minimum_p = minimum;
 
-    free (data);
+    arena_reset (input_arena);
     free (cumsizes);
 }
 
+static void
+print_subset (output_t *out, const double *volumes, const ghss_index_t *selected, ghss_index_t k)
+{
+    ghss_index_t i;
+
+    if (outflag == OUTPUT_BINARY_FLAG) {
+        output_binary (out, selected, volumes, k);
+        output_flush (out);
+        return;
+    }
+
+    if (verbose_flag == 2 && outflag != 2) output_string (out, "# index");
+    
+    double volk = 0;
+    switch(outflag){
+        
+        case 0: //print indices as in case 1
+        case 1:
+        case 2:
+            
+            if (verbose_flag == 2 && outflag != 2) output_char (out, '\n');
+            for(i = 0; i < k; i++){
+                volk += volumes[i];
+                if(outflag != 2){
+                    output_index (out, selected[i]);
+                    output_char (out, '\n');
+                }
+            }
+            if(outflag != 1){
+                if(verbose_flag == 2) output_string (out, "# hypervolume indicator\n");
+                output_double (out, volk);
+                output_char (out, '\n');
+            }
+            break;
+        
+        case 3:
+        case OUTPUT_REMAINING_FLAG:
+            
+            if (verbose_flag == 2) output_string (out, " contribution\n");
+            for(i = 0; i < k; i++){
+                output_index (out, selected[i]);
+                output_char (out, '\t');
+                output_double (out, volumes[i]);
+                output_char (out, '\n');
+            }
+            break;
+            
+        case 4:
+            if (verbose_flag == 2) output_string (out, " accumulated_contribution\n");
+            for(i = 0; i < k; i++){
+                volk += volumes[i];
+                output_index (out, selected[i]);
+                output_char (out, '\t');
+                output_double (out, volk);
+                output_char (out, '\n');
+            }
+            break;
+            
+        default:
+            output_string (out, "wrong flag code! ");
+            output_index (out, outflag);
+            output_char (out, '\n');
+    }
+    output_flush (out);
+}
+
+/* index and contribution of the points of a set of N points that are not among the K selected */
+static void
+print_remaining (output_t *out, const double *remaining, const ghss_index_t *selected,
+                 ghss_index_t k, ghss_index_t n)
+{
+    bool *in = calloc (n, sizeof(bool));
+    ghss_index_t i;
+
+    for (i = 0; i < k; i++)
+        in[selected[i]] = true;
+    if (verbose_flag == 2) output_string (out, "# not selected: index contribution\n");
+    for (i = 0; i < n; i++) {
+        if (in[i])
+            continue;
+        output_index (out, i);
+        output_char (out, '\t');
+        output_double (out, remaining[i]);
+        output_char (out, '\n');
+    }
+    output_flush (out);
+    free (in);
+}
+
+/* order of the points of each set along each dimension (see greedyhss_sort) */
+static ghss_index_t *
+sort_sets (const double *data, int nobj, const ghss_index_t *cumsizes, int nsets)
+{
+    ghss_index_t *perm = malloc ((size_t) nobj * cumsizes[nsets - 1] * sizeof(ghss_index_t));
+    ghss_index_t cumsize;
+    int n;
+
+    for (n = 0, cumsize = 0; n < nsets; cumsize = cumsizes[n], n++)
+        greedyhss_sort (&data[(size_t) nobj * cumsize], nobj, cumsizes[n] - cumsize,
+                        &perm[(size_t) nobj * cumsize]);
+    return perm;
+}
+
+/* with --suffix, the output file of FILENAME (in *OUTFILENAME_P), otherwise stdout */
+static FILE *
+open_outfile (const char *filename, char **outfilename_p)
+{
+    char *outfilename;
+    FILE *outfile;
+
+    *outfilename_p = NULL;
+    if (filename == stdin_name || !suffix)
+        return stdout;
+
+    outfilename = malloc (strlen(filename) + strlen(suffix) + 1);
+    strcpy (outfilename, filename);
+    strcat (outfilename, suffix);
+
+    outfile = fopen (outfilename, "w");
+    if (outfile == NULL) {
+        errprintf ("%s: %s\n", outfilename, strerror(errno));
+        exit (EXIT_FAILURE);
+    }
+    *outfilename_p = outfilename;
+    return outfile;
+}
+
+static void
+close_outfile (FILE *outfile, const char *filename, char *outfilename)
+{
+    if (outfilename) {
+        if (verbose_flag)
+            fprintf (stderr, "# %s -> %s\n", filename, outfilename);
+        fclose (outfile);
+        free (outfilename);
+    }
+}
+
+/* as file_range, reading FILENAME a chunk at a time */
+static void
+stream_range (const char *filename, double **maximum_p, double **minimum_p,
+              int *dim_p)
+{
+    double *data = malloc ((size_t) stream_chunk * READ_STREAM_MAXOBJ * sizeof(double));
+    read_stream_t *s = read_stream_open (filename);
+    ghss_index_t n;
+    bool end;
+
+    if (read_stream_eof (s)) {
+        errprintf ("%s: no input data.", filename);
+        exit (EXIT_FAILURE);
+    }
+    while (!read_stream_eof (s)) {
+        n = read_stream_points (s, data, stream_chunk, dim_p, &end);
+        if (n > 0)
+            data_range (maximum_p, minimum_p, data, *dim_p, n);
+    }
+    read_stream_close (s);
+    free (data);
+}
+
+static void
+print_stream_stats (const char *filename, int nrun, const stream_stats_t *stats)
+{
+    fprintf (stderr, "# stream: %s (set %d)\n", filename, nrun + 1);
+    fprintf (stderr, "#   points              %" GHSS_PRIindex "\n", stats->npoints);
+    fprintf (stderr, "#   chunk size          %" GHSS_PRIindex "\n", stats->chunk);
+    fprintf (stderr, "#   candidates          %" GHSS_PRIindex "\n", candidates);
+    fprintf (stderr, "#   passes              %d\n", stats->passes);
+    fprintf (stderr, "#   reductions          %" GHSS_PRIindex "\n", stats->reductions);
+    fprintf (stderr, "#   peak RSS (kB)       %ld\n", stats->peak_rss);
+}
+
+/* gHSS_file with --memory-limit: each set is read a chunk at a time (see
+   stream_select), and there is one reference point. Without it, the
+   reference point is the maximum found in a first pass over FILENAME,
+   which cannot be standard input.  */
+static void
+stream_file (const char *filename, double *reference,
+             double *maximum, double *minimum, int *nobj_p)
+{
+    const char *name = (filename) ? filename : stdin_name;
+    char *outfilename;
+    FILE *outfile;
+    output_t *out;
+    bool text = (outflag != OUTPUT_BINARY_FLAG); /* comments and blank lines are written */
+    bool setmax = false;
+    bool setref = false;
+    read_stream_t *s;
+    stream_stats_t stats;
+    timer_phase_t phase;
+    double *volumes, volume;
+    ghss_index_t *selected, i, k;
+    int n;
+
+    if (reference == NULL && maximum == NULL) {
+        if (filename == NULL) {
+            errprintf ("%s: --memory-limit requires -r to read standard input", name);
+            exit (EXIT_FAILURE);
+        }
+        setmax = true;
+        stream_range (filename, &maximum, &minimum, nobj_p);
+    }
+    if (reference == NULL) {
+        setref = true;
+        reference = malloc (*nobj_p * sizeof(double));
+        for (n = 0; n < *nobj_p; n++)
+            reference[n] = maximum[n];
+    }
+
+    outfile = open_outfile (name, &outfilename);
+    out = output_new (outfile, shortest_flag);
+    if (out == NULL)
+        errprintf ("%s", strerror (errno));
+
+    if (verbose_flag == 2 && text) {
+        printf ("# file: %s\n", name);
+        if (setmax) {
+            printf ("# maximum:");
+            vector_printf (maximum, *nobj_p);
+            printf ("\n");
+            printf ("# minimum:");
+            vector_printf (minimum, *nobj_p);
+            printf ("\n");
+        }
+        printf ("# reference:");
+        vector_printf (reference, *nobj_p);
+        printf ("\n");
+    }
+
+    s = read_stream_open (filename);
+    if (read_stream_eof (s)) {
+        errprintf ("%s: no input data.", name);
+        exit (EXIT_FAILURE);
+    }
+    volumes = malloc (ksub * sizeof(double));
+    selected = malloc (ksub * sizeof(ghss_index_t));
+
+    for (n = 0; !read_stream_eof (s); n++) {
+        if (verbose_flag == 2 && text)
+            fprintf (outfile, "# Data set %d:\n", n + 1);
+
+        Timer_phase_start (&phase);
+        k = stream_select (s, nobj_p, ksub, candidates, stream_chunk, reference,
+                           union_flag, volumes, selected, &stats);
+        Timer_phase_stop (&phase);
+
+        if (timings_flag)
+            print_timing (name, n + 1, stats.npoints, k, "stream", phase.wall, phase.cpu);
+        if (verbose_flag == 1 || verbose_flag == 2)
+            print_stream_stats (name, n, &stats);
+
+        for (i = 0, volume = 0; i < k; i++)
+            volume += volumes[i];
+        if (volume <= 0.0)
+            warnprintf ("none of the points dominates the reference point\n");
+
+        print_subset (out, volumes, selected, k);
+
+        if (text && verbose_flag == 2)
+            fprintf (outfile, "# Time computing gHSS (cpu): %f seconds\n", phase.cpu);
+        else if (text && verbose_flag == 3)
+            fprintf (outfile, "%f\n", phase.cpu);
+        if ((n > 0 || !read_stream_eof (s)) && text)
+            fprintf (outfile, "\n");
+    }
+
+    read_stream_close (s);
+    free (volumes);
+    free (selected);
+    output_delete (out);
+    close_outfile (outfile, name, outfilename);
+    if (setmax) {
+        free (maximum);
+        free (minimum);
+    }
+    if (setref) free (reference);
+}
+
 /*
    FILENAME: input filename. If NULL, read stdin.
 
-   REFERENCE: reference point. If NULL, use MAXIMUM.
+   REFERENCE: the NREFS reference points. If NULL, use MAXIMUM.
 
    MAXIMUM: maximum objective vector. If NULL, caculate it from the
    input file.
@@ -262,46 +756,84 @@ gHSS_file (const char *filename, double *reference,
          double *maximum, double *minimum, int *nobj_p)
 {
     double *data = NULL;
-    int *cumsizes = NULL;
-    int cumsize;
+    ghss_index_t *cumsizes = NULL;
+    ghss_index_t cumsize;
     int nruns = 0;
-    int n, k;
+    int n;
+    ghss_index_t k;
     int nobj = *nobj_p;
     char *outfilename = NULL;
-    FILE *outfile = stdout;
+    FILE *outfile;
+    output_t *out;
+    bool text = (outflag != OUTPUT_BINARY_FLAG); /* comments and blank lines are written */
     bool setmax = false;
     bool setref = false;
+    int nref = (reference) ? nrefs : 1;
+    ghss_index_t *perm = NULL;
+    char *cachename = NULL;
+    bool cached = false;
+    struct stat st;
+    timer_phase_t phase;
+
+    if (memory_limit) {
+        stream_file (filename, reference, maximum, minimum, nobj_p);
+        return;
+    }
 
-    int err = read_data (filename, &data, &nobj, &cumsizes, &nruns);
+    Timer_phase_start (&phase);
+    if (filename && cache_suffix) {
+        cachename = malloc (strlen(filename) + strlen(cache_suffix) + 1);
+        strcpy (cachename, filename);
+        strcat (cachename, cache_suffix);
+        cached = cache_load (cachename, filename, union_flag, input_arena,
+                             &data, &nobj, &cumsizes, &nruns, &perm);
+        /* taken before reading, so that a change made meanwhile makes the sidecar stale */
+        if (!cached && stat (filename, &st) != 0) {
+            free (cachename);
+            cachename = NULL;
+        }
+    }
+    int err = (cached) ? 0 : read_data (filename, input_arena, &data, &nobj, &cumsizes, &nruns);
+    Timer_phase_stop (&phase);
     if (!filename) filename = stdin_name;
     handle_read_data_error (err, filename);
-
-    if (filename != stdin_name && suffix) {
-        int outfilename_len = strlen(filename) + strlen(suffix) + 1;
-
-        outfilename = malloc (sizeof(char) * outfilename_len);
-        strcpy (outfilename, filename);
-        strcat (outfilename, suffix);
-
-        outfile = fopen (outfilename, "w");
-        if (outfile == NULL) {
-            errprintf ("%s: %s\n", outfilename, strerror(errno));
-            exit (EXIT_FAILURE);
-        }
+    if (timings_flag)
+        print_timing (filename, 0, cumsizes[nruns - 1], 0, "read", phase.wall, phase.cpu);
+
+    if (cachename && !cached) {
+        Timer_phase_start (&phase);
+        if (nobj == 2 || nobj == 3)
+            perm = (union_flag) ? sort_sets (data, nobj, &cumsizes[nruns - 1], 1)
+                                : sort_sets (data, nobj, cumsizes, nruns);
+        if (cache_save (cachename, filename, &st, union_flag, data, nobj,
+                        cumsizes, nruns, perm) != 0)
+            warnprintf ("%s: %s", cachename, strerror (errno));
+        Timer_phase_stop (&phase);
+        if (timings_flag)
+            print_timing (filename, 0, cumsizes[nruns - 1], 0, "cache", phase.wall, phase.cpu);
     }
 
+    outfile = open_outfile (filename, &outfilename);
+    out = output_new (outfile, shortest_flag);
+    if (out == NULL)
+        errprintf ("%s", strerror (errno));
+
     if (union_flag) {
         cumsizes[0] = cumsizes[nruns - 1];
         nruns = 1;
     }
 
-    if (verbose_flag == 2)
+    if (verbose_flag == 2 && text) {
         printf("# file: %s\n", filename);
+        if (cachename)
+            printf("# cache: %s (%s)\n", cachename, (cached) ? "read" : "written");
+    }
 
+    Timer_phase_start (&phase);
     if (maximum == NULL) {
         setmax = true;
         data_range (&maximum, &minimum, data, nobj, cumsizes[nruns-1]);
-        if (verbose_flag == 2) {
+        if (verbose_flag == 2 && text) {
             printf ("# maximum:");
             vector_printf (maximum, nobj);
             printf ("\n");
@@ -312,8 +844,8 @@ gHSS_file (const char *filename, double *reference,
     }
 
     if (reference != NULL) {
-        for (n = 0; n < nobj; n++) {
-            if (reference[n] <= maximum[n]) {
+        for (n = 0; n < nobj * nref; n++) {
+            if (reference[n] <= maximum[n % nobj]) {
                 warnprintf ("%s: some points do not strictly dominate "
                             "the reference point",
                             filename);
@@ -331,35 +863,71 @@ gHSS_file (const char *filename, double *reference,
             so that extreme points have some influence. */
         }
     }
+    Timer_phase_stop (&phase);
+    if (timings_flag)
+        print_timing (filename, 0, cumsizes[nruns - 1], 0, "reference", phase.wall, phase.cpu);
 
-    if (verbose_flag == 2) {
+    if (verbose_flag == 2 && text) {
         printf ("# reference:");
         vector_printf (reference, nobj);
         printf ("\n");
+        for (n = 1; n < nref; n++) {
+            printf ("#           ");
+            vector_printf (reference + n * nobj, nobj);
+            printf ("\n");
+        }
     }
 
     for (n = 0, cumsize = 0; n < nruns; cumsize = cumsizes[n], n++) {
         double time_elapsed_cpu;
         double volume;
-        int i;
+        double *hv = NULL;
+        double *remaining = NULL;
+        int i, r;
 
-        if (verbose_flag == 2)
+        if (verbose_flag == 2 && text)
             fprintf (outfile, "# Data set %d:\n", n + 1);
 
-        int size = cumsizes[n] - cumsize;
-        
+        ghss_index_t size = cumsizes[n] - cumsize;
+        size_t offset = (size_t) nobj * cumsize;
            
         k = (ksub > 0) ? ((ksub < size) ? ksub : size) : size/2;
-        double * volumes = (double *) malloc(k * sizeof(double));
-        int * selected = (int *) malloc(k * sizeof(int));
+        double * volumes = (double *) malloc((size_t) nref * k * sizeof(double));
+        ghss_index_t * selected = (ghss_index_t *) malloc((size_t) nref * k * sizeof(ghss_index_t));
         
         
         Timer_start ();
-        volume = greedyhss(&data[nobj * cumsize], nobj, size, k,
-                                    reference, volumes, selected);
+        if (outflag == OUTPUT_REMAINING_FLAG) {
+            remaining = malloc((size_t) size * sizeof(double));
+            volume = greedyhss_remaining(&data[offset], nobj * sizeof(double), sizeof(double), nobj,
+                                         size, k, reference, volumes, selected, remaining);
+        } else if (nref == 1 && !perm) {
+            volume = greedyhss(&data[offset], nobj, size, k,
+                                        reference, volumes, selected);
+        } else {
+            hv = malloc(nref * sizeof(double));
+            if (perm)
+                greedyhss_presorted(&data[offset], &perm[offset], nobj, size, k,
+                                    reference, nref, volumes, selected, hv);
+            else
+                greedyhss_multiref(&data[offset], nobj, size, k,
+                                   reference, nref, volumes, selected, hv);
+            for (r = 0, volume = hv[0]; r < nref; r++)
+                if (hv[r] < volume) volume = hv[r];
+        }
         
         time_elapsed_cpu = Timer_elapsed_virtual ();
         
+        if (stats_flag)
+            print_stats (filename, n);
+        
+        if (timings_flag) {
+            ghss_timings_t t;
+            gHSS_get_timings (&t);
+            print_timing (filename, n + 1, size, k, "setup", t.setup_wall, t.setup_cpu);
+            print_timing (filename, n + 1, size, k, "selection", t.selection_wall, t.selection_cpu);
+        }
+        
         
         if (volume <= 0.0) {
 //             errprintf ("none of the points strictly dominates the reference point\n");
@@ -368,73 +936,52 @@ gHSS_file (const char *filename, double *reference,
         }
 
         
-        if (verbose_flag == 2 && outflag != 2) fprintf (outfile, "# index");
-        
-        double volk = 0;
-        switch(outflag){
-            
-            case 0: //print indices as in case 1
-            case 1:
-            case 2:
-                
-                if (verbose_flag == 2 && outflag != 2) fprintf (outfile, "\n");
-                for(i = 0; i < k; i++){
-                    volk += volumes[i];
-                    if(outflag != 2) fprintf (outfile, "%d\n", selected[i]);
-                }
-                if(outflag != 1){
-                    if(verbose_flag == 2) fprintf (outfile, "# hypervolume indicator\n");
-                    fprintf(outfile, "%-16.15g\n", volk);
+        Timer_phase_start (&phase);
+        for (r = 0; r < nref; r++) {
+            if (nref > 1 && text) {
+                if (r > 0) fprintf (outfile, "\n");
+                if (verbose_flag == 2) {
+                    fprintf (outfile, "# reference point %d:", r + 1);
+                    for (i = 0; i < nobj; i++)
+                        fprintf (outfile, " %f", reference[r * nobj + i]);
+                    fprintf (outfile, "\n");
                 }
-                break;
-            
-            case 3:
-                
-                if (verbose_flag == 2) fprintf (outfile, " contribution\n");
-                for(i = 0; i < k; i++){
-                    fprintf (outfile, "%d\t%-16.15g\n", selected[i], volumes[i]);
-                }
-                break;
-                
-            case 4:
-                if (verbose_flag == 2) fprintf (outfile, " accumulated_contribution\n");
-                for(i = 0; i < k; i++){
-                    volk += volumes[i];
-                    fprintf(outfile, "%d\t%-16.15g\n", selected[i], volk);
-                }
-                break;
-                
-            default:
-                fprintf(outfile, "wrong flag code! %d\n", outflag);
+            }
+            print_subset (out, volumes + (size_t) r * k, selected + (size_t) r * k, k);
         }
+        if (remaining)
+            print_remaining (out, remaining, selected, k, size);
+        Timer_phase_stop (&phase);
+        if (timings_flag)
+            print_timing (filename, n + 1, size, k, "output", phase.wall, phase.cpu);
         
     
         
         free(volumes);
         free(selected);
+        free(hv);
+        free(remaining);
 
 
 
-        if (verbose_flag == 2) {
+        if (text && verbose_flag == 2) {
             fprintf (outfile, "# Time computing gHSS (cpu): %f seconds\n", time_elapsed_cpu);
-        }else if(verbose_flag == 3) {
+        }else if(text && verbose_flag == 3) {
             fprintf (outfile, "%f\n", time_elapsed_cpu);
             
 //             fprintf (outfile, "-> %f\n", time_elapsed_cpu);
         }
-        if(nruns > 1) fprintf(outfile, "\n");
+        if(nruns > 1 && text) fprintf(outfile, "\n");
         
 
     }
 
-    if (outfilename) {
-        if (verbose_flag)
-            fprintf (stderr, "# %s -> %s\n", filename, outfilename);
-        fclose (outfile);
-        free (outfilename);
-    }
-    free (data);
+    output_delete (out);
+    close_outfile (outfile, filename, outfilename);
+    arena_reset (input_arena);
     free (cumsizes);
+    free (perm);
+    free (cachename);
     if (setmax){
         free (maximum);
         free (minimum);
@@ -460,10 +1007,23 @@ int main(int argc, char *argv[])
         {"verbose",    no_argument,       NULL, 'v'},
         {"quiet",      no_argument,       NULL, 'q'},
         {"reference",  required_argument, NULL, 'r'},
+        {"reference-file", required_argument, NULL, REFERENCE_FILE_OPTION},
         {"union",      no_argument,       NULL, 'u'},
         {"suffix",     required_argument, NULL, 's'},
         {"subsetsize", required_argument, NULL, 'k'},
         {"format",     required_argument, NULL, 'f'},
+        {"threads",    required_argument, NULL, 't'},
+        {"engine",     required_argument, NULL, 'e'},
+        {"layout",     required_argument, NULL, LAYOUT_OPTION},
+        {"stats",      no_argument,       NULL, STATS_OPTION},
+        {"timings",    optional_argument, NULL, TIMINGS_OPTION},
+        {"reuse-arena", no_argument,      NULL, REUSE_ARENA_OPTION},
+        {"prefault",   no_argument,       NULL, PREFAULT_OPTION},
+        {"serve",      optional_argument, NULL, SERVE_OPTION},
+        {"cache",      optional_argument, NULL, CACHE_OPTION},
+        {"shortest",   no_argument,       NULL, SHORTEST_OPTION},
+        {"memory-limit", required_argument, NULL, MEMORY_LIMIT_OPTION},
+        {"candidates", required_argument, NULL, CANDIDATES_OPTION},
 
         {NULL, 0, NULL, 0} /* marks end of list */
     };
@@ -472,16 +1032,15 @@ int main(int argc, char *argv[])
     program_invocation_short_name = argv[0];
 #endif
 
-    while (0 < (opt = getopt_long (argc, argv, "hVvqur:s:k:f:",
+    while (0 < (opt = getopt_long (argc, argv, "hVvqur:s:k:f:t:e:",
                                    long_options, &longopt_index))) {
         switch (opt) {
         case 'r': // --reference
-            reference = read_reference (optarg, &nobj);
-            if (reference == NULL) {
-                errprintf ("invalid reference point '%s",
-                           optarg);
-                exit (EXIT_FAILURE);
-            }
+            add_reference (&reference, &nobj, optarg, "-r", 0);
+            break;
+
+        case REFERENCE_FILE_OPTION: // --reference-file
+            read_reference_file (&reference, &nobj, optarg);
             break;
 
         case 'u': // --union
@@ -511,7 +1070,7 @@ int main(int argc, char *argv[])
             break;
 
         case 'k':
-            ksub = (strcmp(optarg, "MAX") == 0) ? INT_MAX : atoi(optarg);
+            ksub = (strcmp(optarg, "MAX") == 0) ? GHSS_INDEX_MAX : (ghss_index_t) atoll(optarg);
             break;
             
         case 'f': // 
@@ -520,9 +1079,102 @@ int main(int argc, char *argv[])
             // outflag: 2 - the hypervolume indicator of that subset
             // outflag: 3 - index of selected points and corresponding contribuition at the time the point was selected
             // outflag: 4 - index of selected points and accumulated contribution
-            outflag = atoi(optarg);
+            // outflag: 5 - binary output of the indices and contributions (as in 3)
+            // outflag: 6 - as 3, followed by the index and contribution of each point not selected
+            outflag = (strcmp(optarg, "binary") == 0) ? OUTPUT_BINARY_FLAG : atoi(optarg);
+            break;
+            
+            
+        case 't': // --threads
+#if !GHSS_THREADS
+            warnprintf ("built without threads, option -t is ignored");
+#endif
+            gHSS_set_threads (atoi(optarg));
+            read_data_set_threads (atoi(optarg));
+            break;
+
+        case 'e': // --engine
+            if (strcmp(optarg, "auto") == 0)
+                gHSS_set_engine (GHSS_ENGINE_AUTO);
+            else if (strcmp(optarg, "list") == 0)
+                gHSS_set_engine (GHSS_ENGINE_LIST);
+            else if (strcmp(optarg, "array") == 0)
+                gHSS_set_engine (GHSS_ENGINE_ARRAY);
+            else if (strcmp(optarg, "tree") == 0)
+                gHSS_set_engine (GHSS_ENGINE_TREE);
+            else if (strcmp(optarg, "lazy") == 0)
+                gHSS_set_engine (GHSS_ENGINE_LAZY);
+            else {
+                errprintf ("invalid engine '%s'", optarg);
+                exit (EXIT_FAILURE);
+            }
+            break;
+
+        case LAYOUT_OPTION: // --layout
+            if (strcmp(optarg, "input") == 0)
+                gHSS_set_layout (GHSS_LAYOUT_INPUT);
+            else if (strcmp(optarg, "axis") == 0)
+                gHSS_set_layout (GHSS_LAYOUT_AXIS);
+            else if (strcmp(optarg, "zorder") == 0)
+                gHSS_set_layout (GHSS_LAYOUT_ZORDER);
+            else {
+                errprintf ("invalid layout '%s'", optarg);
+                exit (EXIT_FAILURE);
+            }
+            break;
+            
+        case STATS_OPTION: // --stats
+#if !GHSS_STATS
+            warnprintf ("built without GHSS_STATS (make STATS=1), option --stats is ignored");
+#else
+            stats_flag = true;
+#endif
+            break;
+            
+        case TIMINGS_OPTION: // --timings
+            if (optarg == NULL || strcmp(optarg, "json") == 0)
+                timings_flag = 1;
+            else if (strcmp(optarg, "tsv") == 0)
+                timings_flag = 2;
+            else {
+                errprintf ("invalid timings format '%s'", optarg);
+                exit (EXIT_FAILURE);
+            }
+            break;
+            
+        case REUSE_ARENA_OPTION: // --reuse-arena
+            arena_flags |= GHSS_ARENA_REUSE;
+            break;
+            
+        case PREFAULT_OPTION: // --prefault
+            arena_flags |= GHSS_ARENA_PREFAULT;
+            break;
+            
+        case SERVE_OPTION: // --serve
+            serve_flag = true;
+            serve_path = optarg;
             break;
             
+        case CACHE_OPTION: // --cache
+            cache_suffix = (optarg) ? optarg : ".ghss";
+            break;
+
+        case SHORTEST_OPTION: // --shortest
+            shortest_flag = true;
+            break;
+
+        case MEMORY_LIMIT_OPTION: // --memory-limit
+            memory_limit = optarg;
+            stream_chunk = stream_chunk_size (parse_size (optarg, "--memory-limit"));
+            break;
+
+        case CANDIDATES_OPTION: // --candidates
+            candidates = (ghss_index_t) atoll(optarg);
+            if (candidates < 1) {
+                errprintf ("invalid number of candidates '%s'", optarg);
+                exit (EXIT_FAILURE);
+            }
+            break;
             
         case '?':
             // getopt prints an error message right here
@@ -538,6 +1190,58 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (outflag == OUTPUT_REMAINING_FLAG && nrefs > 1) {
+        errprintf ("output format %d takes only one reference point", OUTPUT_REMAINING_FLAG);
+        exit (EXIT_FAILURE);
+    }
+
+    if (memory_limit) {
+        if (candidates == 0)
+            candidates = ksub;
+        if (ksub <= 0) {
+            errprintf ("--memory-limit requires -k");
+            exit (EXIT_FAILURE);
+        }
+        if (nrefs > 1) {
+            errprintf ("--memory-limit takes only one reference point");
+            exit (EXIT_FAILURE);
+        }
+        if (outflag == OUTPUT_REMAINING_FLAG) {
+            errprintf ("output format %d is not available with --memory-limit", OUTPUT_REMAINING_FLAG);
+            exit (EXIT_FAILURE);
+        }
+        if (candidates < ksub) {
+            errprintf ("--candidates must be at least k");
+            exit (EXIT_FAILURE);
+        }
+        if (stream_chunk / 2 < candidates) {
+            errprintf ("--memory-limit=%s holds %" GHSS_PRIindex " points per chunk, fewer than"
+                       " twice the %" GHSS_PRIindex " candidates", memory_limit, stream_chunk, candidates);
+            exit (EXIT_FAILURE);
+        }
+        if (cache_suffix) {
+            warnprintf ("--cache is ignored with --memory-limit");
+            cache_suffix = NULL;
+        }
+    }
+
+    if (serve_flag) {
+        int err = 0;
+        if (nrefs > 1)
+            warnprintf ("only the first reference point is used by --serve");
+        gHSS_set_arena (arena_flags | GHSS_ARENA_REUSE);
+        if (serve_path)
+            err = serve_socket (serve_path, reference, nobj);
+        else
+            serve_stream (stdin, stdout, reference, nobj);
+        gHSS_set_arena (0);
+        free (reference);
+        return (err < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    gHSS_set_arena (arena_flags);
+    input_arena = arena_new (0, (arena_flags & GHSS_ARENA_PREFAULT) ? ARENA_PREFAULT : 0);
+
     numfiles = argc - optind;
 
     if (numfiles < 1) /* Read stdin.  */
@@ -552,8 +1256,12 @@ int main(int argc, char *argv[])
         if (reference == NULL) {
             /* Calculate the maximum among all input files to use as
                reference point.  */
-            for (k = 0; k < numfiles; k++)
-                file_range (argv[optind + k], &maximum, &minimum, &nobj);
+            for (k = 0; k < numfiles; k++) {
+                if (memory_limit)
+                    stream_range (argv[optind + k], &maximum, &minimum, &nobj);
+                else
+                    file_range (argv[optind + k], &maximum, &minimum, &nobj);
+            }
 
             if (verbose_flag == 2) {
                 printf ("# maximum:");
@@ -573,5 +1281,7 @@ int main(int argc, char *argv[])
     free(archiveParam);
     
     if (reference != NULL) free (reference);
+    arena_delete (input_arena);
+    gHSS_set_arena (0);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,587 @@
+/*************************************************************************
+
+ gHSS: buffered output of the points selected
+
+ ---------------------------------------------------------------------
+
+                        Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+ ----------------------------------------------------------------------
+
+ The results are formatted into a buffer that is written with a single
+ fwrite when it is full, instead of calling fprintf for each number.
+ Indices are converted two digits at a time. Doubles are converted with
+ Grisu2 (F. Loitsch, "Printing floating-point numbers quickly and
+ accurately with integers", PLDI 2010), whose digits always read back as
+ the same double and are the shortest such digits in almost all cases.
+
+ The 15 digits of "%.15g" are generated the same way from an
+ approximation of the double that is off by less than one in its last
+ bit, and are rounded only when that error cannot change the direction
+ of the rounding. The few doubles that are too close to halfway between
+ two roundings (and subnormals) are passed to snprintf, so that the
+ default output is the same as with fprintf.
+
+*************************************************************************/
+
+#include "output.h"
+
+#include <float.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 16                /* of "%-16.15g" */
+
+struct output {
+    FILE *f;
+    bool shortest;
+    size_t len;
+    char buf[OUTPUT_BUFSIZE];
+};
+
+
+
+/* -------------------------------- Grisu2 -------------------------------- */
+
+typedef struct diyfp {
+    uint64_t f;
+    int e;
+} diyfp_t;
+
+#define HIDDEN_BIT   ((uint64_t) 1 << 52)
+#define FRACTION     (HIDDEN_BIT - 1)
+
+/* 10^k for k = -348, -340, ..., 340, as f * 2^e with f normalised */
+static const uint64_t cachedF[87] = {
+    0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull,
+    0xcf42894a5dce35eaull, 0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull,
+    0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full, 0xbe5691ef416bd60cull,
+    0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+    0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull,
+    0xc21094364dfb5637ull, 0x9096ea6f3848984full, 0xd77485cb25823ac7ull,
+    0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull, 0xb23867fb2a35b28eull,
+    0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+    0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull,
+    0xb5b5ada8aaff80b8ull, 0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull,
+    0x964e858c91ba2655ull, 0xdff9772470297ebdull, 0xa6dfbd9fb8e5b88full,
+    0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+    0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull,
+    0xaa242499697392d3ull, 0xfd87b5f28300ca0eull, 0xbce5086492111aebull,
+    0x8cbccc096f5088ccull, 0xd1b71758e219652cull, 0x9c40000000000000ull,
+    0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+    0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull,
+    0x9f4f2726179a2245ull, 0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull,
+    0x83c7088e1aab65dbull, 0xc45d1df942711d9aull, 0x924d692ca61be758ull,
+    0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+    0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull,
+    0x952ab45cfa97a0b3ull, 0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull,
+    0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull, 0x88fcf317f22241e2ull,
+    0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+    0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull,
+    0x8bab8eefb6409c1aull, 0xd01fef10a657842cull, 0x9b10a4e5e9913129ull,
+    0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull, 0x80444b5e7aa7cf85ull,
+    0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+    0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull
+};
+static const int16_t cachedE[87] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const uint64_t pow10[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull,
+    10000000000000000ull, 100000000000000000ull, 1000000000000000000ull,
+    10000000000000000000ull
+};
+
+static diyfp_t
+diyfp_of (double x)
+{
+    uint64_t u;
+    int biased;
+    diyfp_t v;
+
+    memcpy (&u, &x, sizeof(u));
+    biased = (int) ((u >> 52) & 0x7ff);
+    v.f = u & FRACTION;
+    if (biased != 0) {
+        v.f += HIDDEN_BIT;
+        v.e = biased - 1075;
+    } else {
+        v.e = -1074;
+    }
+    return v;
+}
+
+static diyfp_t
+diyfp_normalize (diyfp_t v)
+{
+    int s = __builtin_clzll (v.f);
+    v.f <<= s;
+    v.e -= s;
+    return v;
+}
+
+/* product rounded to 64 bits */
+static diyfp_t
+diyfp_mul (diyfp_t x, diyfp_t y)
+{
+    const uint64_t m32 = 0xffffffffu;
+    uint64_t a = x.f >> 32, b = x.f & m32, c = y.f >> 32, d = y.f & m32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32) + ((uint64_t) 1 << 31);
+    diyfp_t r;
+
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+/* the boundaries of the interval of the reals that round to V, with the
+   exponent of the upper one */
+static void
+boundaries (diyfp_t v, diyfp_t *minus, diyfp_t *plus)
+{
+    diyfp_t pl, mi;
+
+    pl.f = (v.f << 1) + 1;
+    pl.e = v.e - 1;
+    while (!(pl.f & (HIDDEN_BIT << 1))) {
+        pl.f <<= 1;
+        pl.e--;
+    }
+    pl.f <<= 10;
+    pl.e -= 10;
+    if (v.f == HIDDEN_BIT) {
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    } else {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *minus = mi;
+    *plus = pl;
+}
+
+/* 10^-K, such that the product of the upper boundary (of exponent E) and
+   it has an exponent between -60 and -32 */
+static diyfp_t
+cached_power (int e, int *K)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = (int) dk;
+    int i;
+    diyfp_t c;
+
+    if (dk - k > 0.0)
+        k++;
+    i = (k >> 3) + 1;
+    *K = -(-348 + i * 8);
+    c.f = cachedF[i];
+    c.e = cachedE[i];
+    return c;
+}
+
+/* move the last digit towards W while it stays in the interval */
+static void
+grisu_round (char *buf, int len, uint64_t delta, uint64_t rest,
+             uint64_t ten_kappa, uint64_t wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten_kappa
+           && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int
+digit_gen (diyfp_t w, diyfp_t mp, uint64_t delta, char *buf, int *K)
+{
+    diyfp_t one;
+    uint64_t wp_w = mp.f - w.f;
+    uint64_t p2;
+    uint32_t p1;
+    int kappa, len = 0;
+
+    one.f = (uint64_t) 1 << -mp.e;
+    one.e = mp.e;
+    p1 = (uint32_t) (mp.f >> -one.e);
+    p2 = mp.f & (one.f - 1);
+    for (kappa = 1; kappa < 10 && p1 >= pow10[kappa]; kappa++);
+
+    while (kappa > 0) {
+        uint32_t d = p1 / pow10[kappa - 1];
+        uint64_t rest;
+
+        p1 %= pow10[kappa - 1];
+        if (d || len)
+            buf[len++] = (char) ('0' + d);
+        kappa--;
+        rest = ((uint64_t) p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *K += kappa;
+            grisu_round (buf, len, delta, rest, pow10[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+
+    for (;;) {
+        char d;
+
+        p2 *= 10;
+        delta *= 10;
+        d = (char) (p2 >> -one.e);
+        if (d || len)
+            buf[len++] = (char) ('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *K += kappa;
+            grisu_round (buf, len, delta, p2, one.f,
+                         wp_w * ((-kappa < 20) ? pow10[-kappa] : 0));
+            return len;
+        }
+    }
+}
+
+/* Digits of X (finite and positive) in BUF, without trailing zeros, such
+   that X is (reads back from) BUF * 10^K. Returns how many there are.  */
+static int
+grisu2 (double x, char *buf, int *K)
+{
+    diyfp_t v = diyfp_of (x), wm, wp, c, w;
+    int len;
+
+    boundaries (v, &wm, &wp);
+    c = cached_power (wp.e, K);
+    w = diyfp_mul (diyfp_normalize (v), c);
+    wp = diyfp_mul (wp, c);
+    wm = diyfp_mul (wm, c);
+    wm.f++;
+    wp.f--;
+    len = digit_gen (w, wp, wp.f - wm.f, buf, K);
+    while (len > 1 && buf[len - 1] == '0') {
+        len--;
+        (*K)++;
+    }
+    return len;
+}
+
+
+/* Round the LEN digits in BUF up or down, as the part of W left after
+   them, REST, is more or less than half of TEN (one in the last digit),
+   when the error of W, UNIT, cannot change the direction. Returns false
+   when it can.  */
+static bool
+round_counted (char *buf, int len, uint64_t rest, uint64_t ten, uint64_t unit,
+               int *K)
+{
+    int i;
+
+    if (unit >= ten || ten - unit <= unit)
+        return false;
+    if (ten - rest > rest && ten - 2 * rest >= 2 * unit)
+        return true;
+    if (rest > unit && ten - (rest - unit) <= rest - unit) {
+        buf[len - 1]++;
+        for (i = len - 1; i > 0 && buf[i] == '0' + 10; i--) {
+            buf[i] = '0';
+            buf[i - 1]++;
+        }
+        if (buf[0] == '0' + 10) {
+            buf[0] = '1';
+            (*K)++;
+        }
+        return true;
+    }
+    return false;
+}
+
+/* The first COUNT digits of X (finite and positive), correctly rounded,
+   in BUF, such that X is about BUF * 10^K. Returns false when W = X *
+   10^-K, which is off by less than one in its last bit, is too close to
+   halfway between two roundings to tell which one is right.  */
+static bool
+grisu_counted (double x, int count, char *buf, int *K)
+{
+    diyfp_t v = diyfp_normalize (diyfp_of (x)), w;
+    uint64_t one, p2, unit = 1;
+    uint32_t p1;
+    int kappa, len = 0;
+
+    w = diyfp_mul (v, cached_power (v.e, K));
+    one = (uint64_t) 1 << -w.e;
+    p1 = (uint32_t) (w.f >> -w.e);
+    p2 = w.f & (one - 1);
+    for (kappa = 1; kappa < 10 && p1 >= pow10[kappa]; kappa++);
+
+    while (kappa > 0) {
+        buf[len++] = (char) ('0' + p1 / pow10[kappa - 1]);
+        p1 %= pow10[kappa - 1];
+        kappa--;
+        if (len == count) {
+            *K += kappa;
+            return round_counted (buf, len, ((uint64_t) p1 << -w.e) + p2,
+                                  pow10[kappa] << -w.e, unit, K);
+        }
+    }
+    while (len < count && p2 > unit) {
+        p2 *= 10;
+        unit *= 10;
+        buf[len++] = (char) ('0' + (p2 >> -w.e));
+        p2 &= one - 1;
+        kappa--;
+    }
+    if (len < count)
+        return false;
+    *K += kappa;
+    return round_counted (buf, len, p2, one, unit, K);
+}
+
+
+/* ------------------------------- Layout --------------------------------- */
+
+/* Lay out the N digits D, the first of which is at position X (that is,
+   D[0].D[1]... * 10^X), as "%g" does with precision P after removing
+   trailing zeros. Returns the length written to S.  */
+static int
+layout_g (char *s, const char *d, int n, int x, int p)
+{
+    char *t = s;
+    int i;
+
+    if (x >= -4 && x < p) {
+        if (x < 0) {
+            *t++ = '0';
+            *t++ = '.';
+            for (i = x + 1; i < 0; i++)
+                *t++ = '0';
+            memcpy (t, d, n);
+            t += n;
+        } else if (n <= x + 1) {
+            memcpy (t, d, n);
+            t += n;
+            for (i = n; i <= x; i++)
+                *t++ = '0';
+        } else {
+            memcpy (t, d, x + 1);
+            t += x + 1;
+            *t++ = '.';
+            memcpy (t, d + x + 1, n - x - 1);
+            t += n - x - 1;
+        }
+    } else {
+        *t++ = d[0];
+        if (n > 1) {
+            *t++ = '.';
+            memcpy (t, d + 1, n - 1);
+            t += n - 1;
+        }
+        *t++ = 'e';
+        *t++ = (x < 0) ? '-' : '+';
+        if (x < 0)
+            x = -x;
+        if (x >= 100)
+            *t++ = (char) ('0' + x / 100);
+        *t++ = (char) ('0' + x / 10 % 10);
+        *t++ = (char) ('0' + x % 10);
+    }
+    return (int) (t - s);
+}
+
+/* X as "%.15g" (or with the shortest digits, laid out as "%.17g") */
+static int
+format_double (char *s, double x, bool shortest)
+{
+    char digits[24];
+    int n, K, sign = 0;
+    uint64_t bits;
+
+    /* The bits are tested, since -ffast-math folds isfinite and signbit
+       away: infinities, NaNs and -0 are passed to snprintf.  */
+    memcpy (&bits, &x, sizeof(bits));
+    if ((bits >> 52 & 0x7ff) == 0x7ff || bits == UINT64_C(0x8000000000000000))
+        return snprintf (s, 32, "%.15g", x);
+    if (bits >> 63) {
+        s[sign++] = '-';
+        x = -x;
+    }
+    if (x == 0) {
+        s[sign] = '0';
+        return sign + 1;
+    }
+    if (shortest) {
+        n = grisu2 (x, digits, &K);
+        return sign + layout_g (s + sign, digits, n, n + K - 1, 17);
+    }
+    if (x < DBL_MIN || !grisu_counted (x, 15, digits, &K))
+        return snprintf (s, 32, "%.15g", (sign) ? -x : x);
+    for (n = 15; n > 1 && digits[n - 1] == '0'; n--)
+        K++;
+    return sign + layout_g (s + sign, digits, n, n + K - 1, 15);
+}
+
+
+
+/* ------------------------------- Output --------------------------------- */
+
+output_t *
+output_new (FILE *f, bool shortest)
+{
+    output_t *o = malloc (sizeof(output_t));
+
+    if (o == NULL)
+        return NULL;
+    o->f = f;
+    o->shortest = shortest;
+    o->len = 0;
+    return o;
+}
+
+void
+output_delete (output_t *o)
+{
+    if (o == NULL)
+        return;
+    output_flush (o);
+    free (o);
+}
+
+int
+output_flush (output_t *o)
+{
+    size_t len = o->len;
+
+    o->len = 0;
+    if (len > 0 && fwrite (o->buf, 1, len, o->f) != len)
+        return EOF;
+    return 0;
+}
+
+/* make room for LEN more bytes */
+static inline char *
+reserve (output_t *o, size_t len)
+{
+    if (o->len + len > OUTPUT_BUFSIZE)
+        output_flush (o);
+    return o->buf + o->len;
+}
+
+void
+output_write (output_t *o, const void *p, size_t len)
+{
+    if (len > OUTPUT_BUFSIZE) {
+        output_flush (o);
+        fwrite (p, 1, len, o->f);
+        return;
+    }
+    memcpy (reserve (o, len), p, len);
+    o->len += len;
+}
+
+void
+output_string (output_t *o, const char *s)
+{
+    output_write (o, s, strlen (s));
+}
+
+void
+output_char (output_t *o, char c)
+{
+    *reserve (o, 1) = c;
+    o->len++;
+}
+
+void
+output_index (output_t *o, ghss_index_t i)
+{
+    static const char pairs[201] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char tmp[24], *t = tmp + sizeof(tmp);
+    char *s = reserve (o, sizeof(tmp));
+    unsigned long long u = (i < 0) ? 0 - (unsigned long long) i : (unsigned long long) i;
+
+    while (u >= 100) {
+        unsigned r = (unsigned) (u % 100);
+        u /= 100;
+        *--t = pairs[2 * r + 1];
+        *--t = pairs[2 * r];
+    }
+    if (u >= 10) {
+        *--t = pairs[2 * u + 1];
+        *--t = pairs[2 * u];
+    } else {
+        *--t = (char) ('0' + u);
+    }
+    if (i < 0)
+        *--t = '-';
+    memcpy (s, t, tmp + sizeof(tmp) - t);
+    o->len += tmp + sizeof(tmp) - t;
+}
+
+void
+output_double (output_t *o, double x)
+{
+    char *s = reserve (o, 32);
+    int len = format_double (s, x, o->shortest);
+
+    for (; len < WIDTH; len++)
+        s[len] = ' ';
+    o->len += len;
+}
+
+void
+output_binary (output_t *o, const ghss_index_t *selected,
+               const double *volumes, ghss_index_t k)
+{
+    static const char zeros[8];
+    output_header_t h;
+    size_t len = (size_t) k * sizeof(ghss_index_t);
+    ghss_index_t i;
+
+    memset (&h, 0, sizeof(h));
+    memcpy (h.magic, OUTPUT_MAGIC, sizeof(h.magic));
+    h.version = OUTPUT_VERSION;
+    h.byteorder = OUTPUT_BYTEORDER;
+    h.indexsize = sizeof(ghss_index_t);
+    h.k = k;
+    for (i = 0; i < k; i++)
+        h.hv += volumes[i];
+
+    output_write (o, &h, sizeof(h));
+    output_write (o, selected, len);
+    output_write (o, zeros, (8 - len % 8) % 8);
+    output_write (o, volumes, (size_t) k * sizeof(double));
+}
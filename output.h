@@ -0,0 +1,89 @@
+/*************************************************************************
+
+ output.h
+
+ ---------------------------------------------------------------------
+
+                       Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+
+
+*************************************************************************/
+#ifndef GHSS_OUTPUT_H_
+#define GHSS_OUTPUT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gHSS.h"
+
+/* Bytes kept before they are written */
+#define OUTPUT_BUFSIZE (1 << 20)
+
+/* Binary output (-f 5): for each data set and reference point, a header
+   followed by the k indices of the points selected (padded with zeros to
+   a multiple of 8 bytes) and the k contributions (doubles) they had when
+   they were selected, all in the byte order of the machine.  */
+#define OUTPUT_MAGIC     "gHSSsel"
+#define OUTPUT_VERSION   1
+#define OUTPUT_BYTEORDER 0x01020304u
+
+typedef struct output_header {
+    char magic[8];              /* OUTPUT_MAGIC */
+    uint32_t version;           /* OUTPUT_VERSION */
+    uint32_t byteorder;         /* OUTPUT_BYTEORDER */
+    uint32_t indexsize;         /* bytes of each index (8 with GHSS_LARGE) */
+    uint32_t reserved;
+    uint64_t k;
+    double hv;                  /* hypervolume of the subset selected */
+} output_header_t;
+
+typedef struct output output_t;
+
+/* Buffered output to F. With SHORTEST, output_double writes the fewest
+   digits that read back as the same double instead of 15 digits.  */
+output_t *output_new (FILE *f, bool shortest);
+
+/* Write what is left in the buffer and free O (F is not closed) */
+void output_delete (output_t *o);
+
+/* Write the buffer to F. Returns 0, or EOF on a write error.  */
+int output_flush (output_t *o);
+
+void output_write (output_t *o, const void *p, size_t len);
+void output_string (output_t *o, const char *s);
+void output_char (output_t *o, char c);
+
+/* Same as fprintf (F, "%" GHSS_PRIindex, I) */
+void output_index (output_t *o, ghss_index_t i);
+
+/* Same as fprintf (F, "%-16.15g", X), or, if O was created with
+   SHORTEST, with the shortest digits of X (laid out as "%-16.17g").  */
+void output_double (output_t *o, double x);
+
+/* The block of the binary output of K points selected */
+void output_binary (output_t *o, const ghss_index_t *selected,
+                    const double *volumes, ghss_index_t k);
+
+#endif
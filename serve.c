@@ -0,0 +1,546 @@
+/*************************************************************************
+
+ gHSS: server mode
+
+ ---------------------------------------------------------------------
+
+                        Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+ ----------------------------------------------------------------------
+
+ A request is a line
+
+     select n=N d=D k=K [ref=R1,...,RD] [format=F] [shm=NAME [offset=B]
+            [layout=row|col]]
+
+ followed by N lines with the D coordinates of each point, unless the
+ points are given in the POSIX shared memory segment NAME, as N * D
+ doubles starting at byte B (in row-major order by default). The line
+ "quit" stops the server. Each response starts with a line "ok L",
+ followed by L lines of output in format F (as in option -f, 3 by
+ default, 5 excluded), or is a single line "error MESSAGE".
+
+ The buffers, the shared memory segment last mapped and the memory of
+ greedyhss (see gHSS_set_arena) are kept from one request to the next.
+
+*************************************************************************/
+
+#include "serve.h"
+#include "io.h"
+#include "gHSS.h"
+#include "output.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define MAX_OBJ 3
+#define SHM_NAME_MAX 255
+
+typedef struct request {
+    ghss_index_t n, k;
+    int d;
+    int format;
+    bool setref;
+    double ref[MAX_OBJ];
+    char shm[SHM_NAME_MAX + 1];
+    bool useshm;                /* shm was given, even if invalid */
+    size_t offset;
+    bool colmajor;
+} request_t;
+
+/* Buffers kept between requests */
+static char *line = NULL;
+static size_t linesize = 0;
+static double *data = NULL;
+static size_t datasize = 0;
+static double *volumes = NULL;
+static size_t volumesize = 0;
+static ghss_index_t *selected = NULL;
+static size_t selectedsize = 0;
+static double *remaining = NULL;        /* format 6 */
+static size_t remainingsize = 0;
+static bool *in = NULL;
+static size_t insize = 0;
+
+/* Shared memory segment last mapped */
+static struct {
+    char name[SHM_NAME_MAX + 1];
+    dev_t dev;
+    ino_t ino;
+    void *addr;
+    size_t len;
+} segment;
+
+static char message[256];
+
+
+static void *
+grow (void *p, size_t *size, size_t needed, size_t elemsize)
+{
+    if (needed > *size) {
+        *size = (needed > 2 * *size) ? needed : 2 * *size;
+        p = realloc (p, *size * elemsize);
+        if (p == NULL) {
+            errprintf ("out of memory");
+            exit (EXIT_FAILURE);
+        }
+    }
+    return p;
+}
+
+static bool
+parse_int (const char *str, int *value)
+{
+    char *endp;
+    long v;
+
+    errno = 0;
+    v = strtol (str, &endp, 10);
+    if (errno || endp == str || *endp != '\0' || v < 0 || v > INT_MAX)
+        return false;
+    *value = (int) v;
+    return true;
+}
+
+static bool
+parse_index (const char *str, ghss_index_t *value)
+{
+    char *endp;
+    long long v;
+
+    errno = 0;
+    v = strtoll (str, &endp, 10);
+    if (errno || endp == str || *endp != '\0' || v < 0 || v > GHSS_INDEX_MAX)
+        return false;
+    *value = (ghss_index_t) v;
+    return true;
+}
+
+/* Returns NULL or an error message (the first one found). All the fields
+   are read even after an error, so that the points that follow the request
+   can be skipped.  */
+static const char *
+parse_request (char *str, request_t *r)
+{
+    const char *error = NULL;
+    char *refstr = NULL;
+    char *save, *token, *value;
+    bool valid;
+    int i;
+
+    memset (r, 0, sizeof(request_t));
+    r->format = 3;
+    r->n = r->d = r->k = -1;
+
+    for (token = strtok_r (str, " \t\r\n", &save); token != NULL;
+         token = strtok_r (NULL, " \t\r\n", &save)) {
+        value = strchr (token, '=');
+        if (value)
+            *value++ = '\0';
+        valid = true;
+
+        if (value == NULL) {
+            valid = false;
+        } else if (strcmp (token, "n") == 0) {
+            valid = parse_index (value, &r->n);
+        } else if (strcmp (token, "d") == 0) {
+            valid = parse_int (value, &r->d);
+        } else if (strcmp (token, "k") == 0) {
+            valid = parse_index (value, &r->k);
+        } else if (strcmp (token, "format") == 0) {
+            valid = parse_int (value, &r->format) && (r->format <= 4 || r->format == 6);
+        } else if (strcmp (token, "ref") == 0) {
+            refstr = value;
+        } else if (strcmp (token, "shm") == 0) {
+            r->useshm = true;
+            valid = strlen (value) <= SHM_NAME_MAX && *value != '\0';
+            if (valid)
+                strcpy (r->shm, value);
+        } else if (strcmp (token, "offset") == 0) {
+            char *endp;
+            errno = 0;
+            r->offset = strtoull (value, &endp, 10);
+            valid = !errno && endp != value && *endp == '\0'
+                && r->offset % sizeof(double) == 0;
+        } else if (strcmp (token, "layout") == 0) {
+            if (strcmp (value, "row") == 0) r->colmajor = false;
+            else if (strcmp (value, "col") == 0) r->colmajor = true;
+            else valid = false;
+        } else if (error == NULL) {
+            snprintf (message, sizeof(message), "unknown field '%s'", token);
+            error = message;
+        }
+
+        if (!valid && error == NULL) {
+            snprintf (message, sizeof(message), "invalid field '%s'", token);
+            error = message;
+        }
+    }
+
+    if (error)
+        return error;
+    if (r->n < 0 || r->d < 0 || r->k < 0)
+        return "n, d and k are required";
+    if (r->k == 0)
+        return "k must be positive";
+    if (r->d < 2 || r->d > MAX_OBJ)
+        return "d must be 2 or 3";
+    if ((size_t) r->n > SIZE_MAX / sizeof(double) / r->d)
+        return "n is too large";
+
+    if (refstr) {
+        char *endp;
+        for (i = 0; i < r->d; i++) {
+            r->ref[i] = strtod (refstr, &endp);
+            if (endp == refstr || *endp != ((i < r->d - 1) ? ',' : '\0'))
+                return "ref must have d comma-separated coordinates";
+            refstr = endp + 1;
+        }
+        r->setref = true;
+    }
+    return NULL;
+}
+
+/* Skip the N lines of points that follow a request that failed */
+static void
+skip_points (FILE *in, ghss_index_t n)
+{
+    ghss_index_t i;
+
+    for (i = 0; i < n; i++)
+        if (getline (&line, &linesize, in) < 0)
+            return;
+}
+
+/* Read the N lines of points of request R into DATA. All of them are read
+   even after an error, so that the next request is found.  */
+static const char *
+read_points (FILE *in, const request_t *r)
+{
+    const char *error = NULL;
+    char *cursor, *endp;
+    ghss_index_t i;
+    int j;
+
+    data = grow (data, &datasize, (size_t) r->n * r->d, sizeof(double));
+
+    for (i = 0; i < r->n; i++) {
+        if (getline (&line, &linesize, in) < 0)
+            return "unexpected end of input";
+        if (error) continue;
+
+        cursor = line;
+        for (j = 0; j < r->d; j++) {
+            data[(size_t) i * r->d + j] = strtod (cursor, &endp);
+            if (endp == cursor)
+                break;
+            cursor = endp;
+        }
+        while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'
+               || *cursor == '\n')
+            cursor++;
+        if (j < r->d || *cursor != '\0') {
+            snprintf (message, sizeof(message),
+                      "point %" GHSS_PRIindex ": expected %d coordinates", i + 1, r->d);
+            error = message;
+        }
+    }
+    return error;
+}
+
+/* Map (or reuse the mapping of) the segment of request R */
+static const char *
+map_segment (const request_t *r, const char **base)
+{
+    size_t needed;
+    struct stat st;
+    int fd;
+
+    if ((size_t) r->n * r->d > (SIZE_MAX - r->offset) / sizeof(double)) {
+        snprintf (message, sizeof(message), "%s: offset and n*d doubles exceed the address space",
+                  r->shm);
+        return message;
+    }
+    needed = r->offset + (size_t) r->n * r->d * sizeof(double);
+
+    fd = shm_open (r->shm, O_RDONLY, 0);
+    if (fd < 0 || fstat (fd, &st) < 0) {
+        snprintf (message, sizeof(message), "%s: %s", r->shm, strerror (errno));
+        if (fd >= 0) close (fd);
+        return message;
+    }
+    if ((size_t) st.st_size < needed) {
+        close (fd);
+        snprintf (message, sizeof(message), "%s: segment has %lld bytes, %zu are needed",
+                  r->shm, (long long) st.st_size, needed);
+        return message;
+    }
+
+    if (segment.addr == NULL || strcmp (segment.name, r->shm) != 0
+        || segment.dev != st.st_dev || segment.ino != st.st_ino
+        || segment.len < needed) {
+        if (segment.addr)
+            munmap (segment.addr, segment.len);
+        segment.addr = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (segment.addr == MAP_FAILED) {
+            segment.addr = NULL;
+            close (fd);
+            snprintf (message, sizeof(message), "%s: %s", r->shm, strerror (errno));
+            return message;
+        }
+        strcpy (segment.name, r->shm);
+        segment.dev = st.st_dev;
+        segment.ino = st.st_ino;
+        segment.len = st.st_size;
+    }
+    close (fd);
+    *base = (const char *) segment.addr + r->offset;
+    return NULL;
+}
+
+/* index and double of one line of formats 3, 4 and 6 */
+static void
+write_line (output_t *o, ghss_index_t i, double x)
+{
+    output_index (o, i);
+    output_char (o, '\t');
+    output_double (o, x);
+    output_char (o, '\n');
+}
+
+static void
+write_response (output_t *o, const request_t *r, ghss_index_t k)
+{
+    double volk = 0;
+    ghss_index_t i, nlines;
+
+    switch (r->format) {
+    case 0: nlines = k + 1; break;
+    case 2: nlines = 1; break;
+    case 6: nlines = r->n; break;
+    default: nlines = k;
+    }
+    output_string (o, "ok ");
+    output_index (o, nlines);
+    output_char (o, '\n');
+
+    for (i = 0; i < k; i++) {
+        volk += volumes[i];
+        switch (r->format) {
+        case 0:
+        case 1:
+            output_index (o, selected[i]);
+            output_char (o, '\n');
+            break;
+        case 3:
+        case 6:
+            write_line (o, selected[i], volumes[i]);
+            break;
+        case 4:
+            write_line (o, selected[i], volk);
+            break;
+        }
+    }
+    if (r->format == 0 || r->format == 2) {
+        output_double (o, volk);
+        output_char (o, '\n');
+    }
+
+    if (r->format == 6) {
+        in = grow (in, &insize, r->n, sizeof(bool));
+        memset (in, 0, r->n * sizeof(bool));
+        for (i = 0; i < k; i++)
+            in[selected[i]] = true;
+        for (i = 0; i < r->n; i++)
+            if (!in[i])
+                write_line (o, i, remaining[i]);
+    }
+}
+
+static const char *
+select_points (FILE *in, output_t *o, request_t *r,
+               const double *reference, int nobj)
+{
+    const char *error;
+    const char *base;
+    ptrdiff_t rowstride, colstride;
+    ghss_index_t i, k;
+    int j;
+
+    if (r->shm[0]) {
+        if ((error = map_segment (r, &base)) != NULL)
+            return error;
+    } else {
+        if ((error = read_points (in, r)) != NULL)
+            return error;
+        base = (const char *) data;
+    }
+    if (r->n == 0)
+        return "no points";
+
+    if (r->colmajor) {
+        rowstride = sizeof(double);
+        colstride = r->n * sizeof(double);
+    } else {
+        rowstride = r->d * sizeof(double);
+        colstride = sizeof(double);
+    }
+
+    if (!r->setref && reference) {
+        if (nobj != r->d)
+            return "the reference point of the server has a different dimension";
+        memcpy (r->ref, reference, r->d * sizeof(double));
+    } else if (!r->setref) {
+        /* coordinate-wise maximum, as for the input files */
+        for (j = 0; j < r->d; j++) {
+            r->ref[j] = *(const double *) (base + j * colstride);
+            for (i = 1; i < r->n; i++) {
+                double x = *(const double *) (base + i * rowstride + j * colstride);
+                if (x > r->ref[j]) r->ref[j] = x;
+            }
+        }
+    }
+
+    k = (r->k < r->n) ? r->k : r->n;
+    volumes = grow (volumes, &volumesize, k, sizeof(double));
+    selected = grow (selected, &selectedsize, k, sizeof(ghss_index_t));
+
+    if (r->format == 6) {
+        remaining = grow (remaining, &remainingsize, r->n, sizeof(double));
+        greedyhss_remaining ((const double *) base, rowstride, colstride, r->d, r->n,
+                             k, r->ref, volumes, selected, remaining);
+    } else {
+        greedyhss_strided ((const double *) base, rowstride, colstride, r->d, r->n,
+                           k, r->ref, volumes, selected);
+    }
+
+    write_response (o, r, k);
+    return NULL;
+}
+
+int
+serve_stream (FILE *in, FILE *out, const double *reference, int nobj)
+{
+    output_t *o = output_new (out, false);
+    const char *error;
+    request_t r;
+    char *cmd;
+    size_t len;
+    int quit = 0;
+
+    if (o == NULL) {
+        errprintf ("out of memory");
+        exit (EXIT_FAILURE);
+    }
+
+    while (!quit && getline (&line, &linesize, in) >= 0) {
+        cmd = line + strspn (line, " \t\r\n");
+        len = strcspn (cmd, " \t\r\n");
+        if (len == 0)
+            continue;
+
+        error = NULL;
+        if (len == 4 && strncmp (cmd, "quit", 4) == 0) {
+            output_string (o, "ok 0\n");
+            quit = 1;
+        } else if (len == 6 && strncmp (cmd, "select", 6) == 0) {
+            error = parse_request (cmd + len, &r);
+            if (error == NULL)
+                error = select_points (in, o, &r, reference, nobj);
+            else if (r.n > 0 && r.d > 0 && !r.useshm)
+                skip_points (in, r.n);
+        } else {
+            error = "unknown request";
+        }
+
+        if (error) {
+            output_string (o, "error ");
+            output_string (o, error);
+            output_char (o, '\n');
+        }
+        output_flush (o);
+        fflush (out);
+    }
+    output_delete (o);
+    return quit;
+}
+
+int
+serve_socket (const char *path, const double *reference, int nobj)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd, conn, quit = 0;
+    FILE *in, *out;
+
+    if (strlen (path) >= sizeof(addr.sun_path)) {
+        warnprintf ("%s: socket path too long", path);
+        return -1;
+    }
+    memset (&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy (addr.sun_path, path);
+
+    /* replace a socket left behind by a previous server */
+    if (stat (path, &st) == 0 && S_ISSOCK (st.st_mode))
+        unlink (path);
+
+    fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind (fd, (struct sockaddr *) &addr, sizeof(addr)) < 0
+        || listen (fd, 8) < 0) {
+        warnprintf ("%s: %s", path, strerror (errno));
+        if (fd >= 0) close (fd);
+        return -1;
+    }
+
+    /* a client that goes away must not stop the server */
+    signal (SIGPIPE, SIG_IGN);
+
+    while (!quit) {
+        conn = accept (fd, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            warnprintf ("%s: %s", path, strerror (errno));
+            break;
+        }
+        in = fdopen (conn, "r");
+        out = fdopen (dup (conn), "w");
+        quit = serve_stream (in, out, reference, nobj);
+        fclose (out);
+        fclose (in);
+    }
+
+    close (fd);
+    unlink (path);
+    return 0;
+}
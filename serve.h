@@ -0,0 +1,48 @@
+/*************************************************************************
+
+ serve.h
+
+ ---------------------------------------------------------------------
+
+                       Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+
+
+*************************************************************************/
+#ifndef GHSS_SERVE_H_
+#define GHSS_SERVE_H_
+
+#include <stdio.h>
+
+/* Answer the requests read from IN, writing the responses to OUT, until
+   the end of IN or a quit request (see README for the protocol).
+   REFERENCE (of dimension NOBJ, may be NULL) is used by the requests that
+   do not give a reference point. Returns 1 after a quit request and 0
+   otherwise.  */
+int serve_stream (FILE *in, FILE *out, const double *reference, int nobj);
+
+/* Same as serve_stream, for each connection to a Unix domain socket
+   bound to PATH (one connection at a time), until a quit request.
+   Returns 0, or -1 if the socket could not be set up.  */
+int serve_socket (const char *path, const double *reference, int nobj);
+
+#endif
@@ -0,0 +1,254 @@
+/*************************************************************************
+
+ gHSS: greedy selection on inputs read a chunk at a time (merge and reduce)
+
+ ---------------------------------------------------------------------
+
+                        Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+ ----------------------------------------------------------------------
+
+ The points of a set are read CHUNK at a time, and each chunk is
+ reduced to the M points that the greedy selection picks first in it.
+ These candidates are added to the first level of a merge tree. When a
+ level cannot take the candidates of another chunk without holding more
+ than CHUNK points, its points are reduced to M in the same way and
+ added to the next level. At the end of the set, the lowest levels are
+ reduced until the points left in all levels fit in one chunk, and the
+ K points are selected among them. At most CHUNK points are given to
+ greedyhss at a time, and each level holds at most CHUNK points, so the
+ memory used depends on CHUNK and on the number of levels (logarithmic
+ in the number of points) but not on the number of points.
+
+ The points selected are those of the greedy selection on the points
+ left at the end, which are not always the ones that the greedy
+ selection on the whole set would pick.
+
+*************************************************************************/
+
+#include "stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+typedef struct level {
+    double *data;               /* coordinates of the points */
+    ghss_index_t *id;           /* their indices in the set */
+    ghss_index_t n;
+} level_t;
+
+typedef struct reducer {
+    int nobj;
+    ghss_index_t m, chunk;
+    const double *ref;
+    level_t *level;
+    int nlevels;
+    double *volumes;            /* M contributions */
+    ghss_index_t *selected;     /* M indices */
+    stream_stats_t *stats;
+} reducer_t;
+
+
+
+static void *
+xmalloc (size_t size)
+{
+    void *p = malloc (size);
+
+    if (p == NULL)
+        errprintf ("out of memory");
+    return p;
+}
+
+static int
+compare_index (const void *a, const void *b)
+{
+    ghss_index_t x = *(const ghss_index_t *) a, y = *(const ghss_index_t *) b;
+    return (x > y) - (x < y);
+}
+
+static long
+peak_rss (void)
+{
+    struct rusage ru;
+
+    if (getrusage (RUSAGE_SELF, &ru) != 0)
+        return 0;
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;     /* in bytes */
+#else
+    return ru.ru_maxrss;
+#endif
+}
+
+ghss_index_t
+stream_chunk_size (size_t memory)
+{
+    size_t n = memory / STREAM_POINT_BYTES;
+
+    return (n > (size_t) GHSS_INDEX_MAX) ? GHSS_INDEX_MAX : (ghss_index_t) n;
+}
+
+
+
+/* Keep the M points of DATA and ID (N points) that the greedy selection
+   picks first, moved to the front in their order. Returns how many are
+   kept.  */
+static ghss_index_t
+reduce (reducer_t *r, double *data, ghss_index_t *id, ghss_index_t n)
+{
+    ghss_index_t j, s;
+
+    if (n <= r->m)
+        return n;
+    greedyhss (data, r->nobj, n, r->m, r->ref, r->volumes, r->selected);
+    r->stats->reductions++;
+
+    /* in increasing order, each point moves down, over points already moved */
+    qsort (r->selected, r->m, sizeof(ghss_index_t), compare_index);
+    for (j = 0; j < r->m; j++) {
+        s = r->selected[j];
+        memmove (data + (size_t) j * r->nobj, data + (size_t) s * r->nobj,
+                 r->nobj * sizeof(double));
+        id[j] = id[s];
+    }
+    return r->m;
+}
+
+/* Add the N points DATA (with indices ID) to level I, which is first
+   reduced into the next level if they do not fit.  */
+static void
+push (reducer_t *r, int i, const double *data, const ghss_index_t *id, ghss_index_t n)
+{
+    level_t *l;
+    ghss_index_t kept;
+
+    if (i == r->nlevels) {
+        r->level = realloc (r->level, (i + 1) * sizeof(level_t));
+        if (r->level == NULL)
+            errprintf ("out of memory");
+        r->level[i].data = xmalloc ((size_t) r->chunk * r->nobj * sizeof(double));
+        r->level[i].id = xmalloc ((size_t) r->chunk * sizeof(ghss_index_t));
+        r->level[i].n = 0;
+        r->nlevels++;
+    }
+
+    l = &r->level[i];
+    if (l->n + n > r->chunk) {
+        kept = reduce (r, l->data, l->id, l->n);
+        push (r, i + 1, l->data, l->id, kept);
+        l = &r->level[i];       /* moved if a level was added */
+        l->n = 0;
+    }
+    memcpy (l->data + (size_t) l->n * r->nobj, data, (size_t) n * r->nobj * sizeof(double));
+    memcpy (l->id + l->n, id, n * sizeof(ghss_index_t));
+    l->n += n;
+}
+
+static ghss_index_t
+levels_size (const reducer_t *r)
+{
+    ghss_index_t n = 0;
+    int i;
+
+    for (i = 0; i < r->nlevels; i++)
+        n += r->level[i].n;
+    return n;
+}
+
+
+
+ghss_index_t
+stream_select (read_stream_t *s, int *nobj_p, ghss_index_t k, ghss_index_t m,
+               ghss_index_t chunk, const double *ref, bool union_sets,
+               double *volumes, ghss_index_t *selected, stream_stats_t *stats)
+{
+    reducer_t r;
+    double *data = xmalloc ((size_t) chunk * READ_STREAM_MAXOBJ * sizeof(double));
+    ghss_index_t *id = xmalloc ((size_t) chunk * sizeof(ghss_index_t));
+    ghss_index_t n, i, kept;
+    bool end;
+    int j;
+
+    memset (stats, 0, sizeof(stream_stats_t));
+    stats->chunk = chunk;
+    memset (&r, 0, sizeof(r));
+    r.m = m;
+    r.chunk = chunk;
+    r.ref = ref;
+    r.volumes = xmalloc (m * sizeof(double));
+    r.selected = xmalloc (m * sizeof(ghss_index_t));
+    r.stats = stats;
+
+    do {
+        n = read_stream_points (s, data, chunk, nobj_p, &end);
+        r.nobj = *nobj_p;
+        if (r.nobj != 2 && r.nobj != 3)
+            errprintf ("%d coordinates per point, but only 2 or 3 can be read a chunk at a time",
+                       r.nobj);
+        for (i = 0; i < n; i++)
+            id[i] = stats->npoints + i;
+        stats->npoints += n;
+        if (union_sets && !read_stream_eof (s))
+            end = false;
+        /* a set that fits in one chunk is selected from as a whole */
+        if (end && r.nlevels == 0)
+            break;
+        kept = reduce (&r, data, id, n);
+        push (&r, 0, data, id, kept);
+    } while (!end);
+
+    if (r.nlevels > 0) {
+        /* reduce the lowest levels until the points left fit in one chunk */
+        for (j = 0; j < r.nlevels - 1 && levels_size (&r) > chunk; j++) {
+            kept = reduce (&r, r.level[j].data, r.level[j].id, r.level[j].n);
+            push (&r, j + 1, r.level[j].data, r.level[j].id, kept);
+            r.level[j].n = 0;
+        }
+        for (j = 0, n = 0; j < r.nlevels; j++) {
+            memcpy (data + (size_t) n * r.nobj, r.level[j].data,
+                    (size_t) r.level[j].n * r.nobj * sizeof(double));
+            memcpy (id + n, r.level[j].id, r.level[j].n * sizeof(ghss_index_t));
+            n += r.level[j].n;
+            free (r.level[j].data);
+            free (r.level[j].id);
+        }
+        free (r.level);
+    }
+
+    if (k > n)
+        k = n;
+    if (k > 0) {
+        greedyhss (data, r.nobj, n, k, ref, volumes, selected);
+        stats->reductions++;
+    }
+    for (i = 0; i < k; i++)
+        selected[i] = id[selected[i]];
+    stats->passes = r.nlevels + 1;
+    stats->peak_rss = peak_rss ();
+
+    free (r.selected);
+    free (r.volumes);
+    free (id);
+    free (data);
+    return k;
+}
@@ -0,0 +1,69 @@
+/*************************************************************************
+
+ stream.h
+
+ ---------------------------------------------------------------------
+
+                       Copyright (c) 2016, 2017
+                Andreia P. Guerreiro <apg@dei.uc.pt>
+
+
+ This program is free software (software libre); you can redistribute
+ it and/or modify it under the terms of the GNU General Public License,
+ version 3, as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, you can obtain a copy of the GNU
+ General Public License at:
+                 http://www.gnu.org/copyleft/gpl.html
+ or by writing to:
+           Free Software Foundation, Inc., 59 Temple Place,
+                 Suite 330, Boston, MA 02111-1307 USA
+
+
+
+*************************************************************************/
+#ifndef GHSS_STREAM_H_
+#define GHSS_STREAM_H_
+
+#include <stddef.h>
+
+#include "io.h"
+#include "gHSS.h"
+
+/* Bytes of memory counted for each point of a chunk: the greedy
+   selection on it (the sorted lists of gHSS3D take most of it), its
+   coordinates and those of the candidates kept at each level.  */
+#define STREAM_POINT_BYTES 512
+
+typedef struct stream_stats {
+    ghss_index_t npoints;       /* points read */
+    ghss_index_t chunk;         /* points per chunk */
+    int passes;                 /* levels of the merge tree, the last selection included */
+    ghss_index_t reductions;    /* greedy selections done */
+    long peak_rss;              /* peak resident set size of the process, in kB */
+} stream_stats_t;
+
+/* Points of a chunk for MEMORY bytes (see STREAM_POINT_BYTES) */
+ghss_index_t stream_chunk_size (size_t memory);
+
+/* Select K points of the next set of S (or of all the sets left, if
+   UNION) with the greedy selection for the reference point REF, reading
+   CHUNK points at a time. Each chunk is reduced to its M best points
+   (M >= K, 2 M <= CHUNK), and the candidates of as many chunks as fit
+   in a chunk are merged and reduced to M again, level after level, until
+   the candidates left fit in one chunk, from which the K points are
+   selected. A set of at most CHUNK points is selected from at once, as
+   greedyhss would. The indices (in the set) of the points selected and
+   their contributions are written to SELECTED and VOLUMES as greedyhss
+   writes them, and their number, at most K, is returned.  */
+ghss_index_t stream_select (read_stream_t *s, int *nobj_p, ghss_index_t k, ghss_index_t m,
+                            ghss_index_t chunk, const double *ref, bool union_sets,
+                            double *volumes, ghss_index_t *selected, stream_stats_t *stats);
+
+#endif
@@ -32,6 +32,7 @@
 *************************************************************************/
 
 #include <stdio.h>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 #include "timer.h"
@@ -154,3 +155,34 @@ void Timer_continue(void)
 
     if (timer_tmp_time > 0.0) virtual_time += timer_tmp_time;
 }
+
+/*
+ *  Unlike the functions above, the phase timers use clock_gettime: the
+ *  wall-clock time is monotonic and both times have nanosecond
+ *  resolution (if the system provides it). Any number of phases can be
+ *  timed at the same time.
+ */
+#define TIMER_TIMESPEC(X)  ( (double)X.tv_sec + (double)X.tv_nsec * 1.0E-9 )
+
+void Timer_phase_start(timer_phase_t * phase)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    phase->wall = TIMER_TIMESPEC(t);
+    clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &t);
+    phase->cpu = TIMER_TIMESPEC(t);
+}
+
+/*
+ *  Replace the start times saved in 'phase' by the time elapsed since
+ *  then.
+ */
+void Timer_phase_stop(timer_phase_t * phase)
+{
+    timer_phase_t now;
+
+    Timer_phase_start (&now);
+    phase->wall = now.wall - phase->wall;
+    phase->cpu = now.cpu - phase->cpu;
+}
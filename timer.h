@@ -43,4 +43,13 @@ double Timer_elapsed(TIMER_TYPE type);
 void Timer_stop(void);
 void Timer_continue(void);
 
+/* Wall-clock (monotonic) and CPU time of a phase, in seconds */
+typedef struct timer_phase {
+    double wall;
+    double cpu;
+} timer_phase_t;
+
+void Timer_phase_start(timer_phase_t * phase);
+void Timer_phase_stop(timer_phase_t * phase);
+
 #endif // TIMER_H_